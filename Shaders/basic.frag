@@ -3,6 +3,7 @@
 varying vec3 vNormal;
 varying vec3 pos;
 varying vec2 vUvs;
+varying vec2 vTile;
 
 uniform sampler2D textureAtlas;
 
@@ -11,7 +12,9 @@ const vec3 sun_color = vec3(1.4, 1.2, 0.4);
 const vec4 ambient = vec4(0.3, 0.3, 0.4, 0.0);
 
 void main() {
-	vec4 diffuse = texture2D(textureAtlas, vUvs);
+	// The atlas is 32x32 tiles. Merged faces span several cubes, so the
+	// material's tile is repeated once per cube.
+	vec4 diffuse = texture2D(textureAtlas, (vTile + fract(vUvs)) / 32.0);
 	float cosTheta = clamp(dot(vNormal, sun_dir), 0.0, 1.0);
 	vec4 sun_color_theta = vec4(sun_color * cosTheta, 1.0) + ambient;
 	gl_FragColor = diffuse * sun_color_theta;
@@ -1,11 +1,12 @@
 #version 120
 
 attribute vec4 position;
-attribute vec2 uvs;
+attribute vec4 uvs;
 
 varying vec3 vNormal;
 varying vec3 pos;
 varying vec2 vUvs;
+varying vec2 vTile;
 
 uniform mat4 projViewMatrix;
 uniform mat4 modelMatrix;
@@ -21,7 +22,10 @@ void main() {
 
 	mat4 mvp = projViewMatrix * modelMatrix;
 	gl_Position = mvp * vec4(position.xyz, 1.0);
+	// w holds the side and uvs the atlas tile after the texture coordinates,
+	// see GPUVertex.
 	vNormal = cNormals[int(position.w)];
 	pos = vec3(position);
-	vUvs = uvs;
+	vUvs = uvs.xy;
+	vTile = uvs.zw;
 }
\ No newline at end of file
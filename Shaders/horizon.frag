@@ -0,0 +1,29 @@
+#version 120
+
+varying vec3 vNormal;
+varying vec3 vWorldPos;
+
+// x, z area of the loaded chunks: min x, min z, max x, max z.
+uniform vec4 voxelBounds;
+// Bottom and top of the loaded chunks.
+uniform vec2 voxelHeights;
+
+const vec3 sun_dir = vec3(0.32, 0.75, 0.54);
+const vec3 sun_color = vec3(1.4, 1.2, 0.4);
+const vec4 ambient = vec4(0.3, 0.3, 0.4, 0.0);
+const vec3 grass_color = vec3(0.36, 0.55, 0.24);
+const vec3 dirt_color = vec3(0.47, 0.34, 0.23);
+
+void main() {
+	// The chunks are drawn there instead. Terrain above or below the loaded
+	// layers isn't in any chunk, so it is kept.
+	if (vWorldPos.x > voxelBounds.x && vWorldPos.z > voxelBounds.y && vWorldPos.x < voxelBounds.z && vWorldPos.z < voxelBounds.w &&
+		vWorldPos.y > voxelHeights.x && vWorldPos.y <= voxelHeights.y)
+		discard;
+
+	// Steep slopes show their dirt like the sides of grass cubes do.
+	vec3 diffuse = mix(dirt_color, grass_color, smoothstep(0.6, 0.8, vNormal.y));
+	float cosTheta = clamp(dot(vNormal, sun_dir), 0.0, 1.0);
+	vec4 sun_color_theta = vec4(sun_color * cosTheta, 1.0) + ambient;
+	gl_FragColor = vec4(diffuse, 1.0) * sun_color_theta;
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 120
+
+attribute vec4 position;
+attribute vec2 uvs;
+
+varying vec3 vNormal;
+varying vec3 vWorldPos;
+
+uniform mat4 projViewMatrix;
+uniform mat4 modelMatrix;
+
+void main() {
+	// Heightfield normals always point up, so only x and z are stored.
+	vNormal = vec3(uvs.x, sqrt(max(1.0 - dot(uvs, uvs), 0.0)), uvs.y);
+	vec4 worldPos = modelMatrix * vec4(position.xyz, 1.0);
+	vWorldPos = worldPos.xyz;
+	gl_Position = projViewMatrix * worldPos;
+}
\ No newline at end of file
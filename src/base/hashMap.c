@@ -0,0 +1,142 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base/hashMap.h"
+
+#define HASHMAP_MIN_CAPACITY 16
+
+// Keys are usually packed coordinates, which are terrible hashes on their
+// own. The MurmurHash3 finalizer spreads them over all of the bits.
+static inline U64 hashKey(U64 key) {
+   key ^= key >> 33;
+   key *= 0xFF51AFD7ED558CCDULL;
+   key ^= key >> 33;
+   key *= 0xC4CEB9FE1A85EC53ULL;
+   key ^= key >> 33;
+   return key;
+}
+
+void initHashMap(HashMap *map, U32 initialCapacity) {
+   U32 capacity = HASHMAP_MIN_CAPACITY;
+   while (capacity < initialCapacity)
+      capacity <<= 1;
+
+   memset(map, 0, sizeof(HashMap));
+   map->entries = (HashMapEntry*)calloc(capacity, sizeof(HashMapEntry));
+   map->capacity = capacity;
+}
+
+void freeHashMap(HashMap *map) {
+   free(map->entries);
+   memset(map, 0, sizeof(HashMap));
+}
+
+void* hashMapGet(HashMap *map, U64 key) {
+   if (map->lastValue != NULL && map->lastKey == key)
+      return map->lastValue;
+
+   U32 mask = map->capacity - 1;
+   for (U32 i = (U32)hashKey(key) & mask; map->entries[i].value != NULL; i = (i + 1) & mask) {
+      if (map->entries[i].key == key) {
+         map->lastKey = key;
+         map->lastValue = map->entries[i].value;
+         return map->entries[i].value;
+      }
+   }
+   return NULL;
+}
+
+static void placeEntry(HashMap *map, U64 key, void *value) {
+   U32 mask = map->capacity - 1;
+   U32 i = (U32)hashKey(key) & mask;
+   while (map->entries[i].value != NULL && map->entries[i].key != key)
+      i = (i + 1) & mask;
+
+   if (map->entries[i].value == NULL)
+      map->count++;
+   map->entries[i].key = key;
+   map->entries[i].value = value;
+}
+
+void hashMapInsert(HashMap *map, U64 key, void *value) {
+   assert(value != NULL);
+
+   // Keep the load factor under 70% so probe sequences stay short.
+   if ((map->count + 1) * 10 > map->capacity * 7) {
+      HashMapEntry *old = map->entries;
+      U32 oldCapacity = map->capacity;
+
+      map->capacity *= 2;
+      map->count = 0;
+      map->entries = (HashMapEntry*)calloc(map->capacity, sizeof(HashMapEntry));
+      for (U32 i = 0; i < oldCapacity; ++i) {
+         if (old[i].value != NULL)
+            placeEntry(map, old[i].key, old[i].value);
+      }
+      free(old);
+   }
+
+   placeEntry(map, key, value);
+
+   if (map->lastKey == key)
+      map->lastValue = value;
+}
+
+void* hashMapRemove(HashMap *map, U64 key) {
+   U32 mask = map->capacity - 1;
+   U32 i = (U32)hashKey(key) & mask;
+   while (map->entries[i].value != NULL && map->entries[i].key != key)
+      i = (i + 1) & mask;
+
+   void *value = map->entries[i].value;
+   if (value == NULL)
+      return NULL;
+
+   if (map->lastKey == key)
+      map->lastValue = NULL;
+
+   // Backward shift deletion. Pull any entry that probed past the hole back
+   // into it so that lookups never need tombstones.
+   U32 hole = i;
+   for (U32 j = (i + 1) & mask; map->entries[j].value != NULL; j = (j + 1) & mask) {
+      U32 home = (U32)hashKey(map->entries[j].key) & mask;
+      bool canMove = hole <= j ? (home <= hole || home > j) : (home <= hole && home > j);
+      if (canMove) {
+         map->entries[hole] = map->entries[j];
+         hole = j;
+      }
+   }
+   map->entries[hole].value = NULL;
+   map->count--;
+
+   return value;
+}
+
+void* hashMapNext(const HashMap *map, U32 *iterator, U64 *key) {
+   for (; *iterator < map->capacity; ++(*iterator)) {
+      HashMapEntry *entry = &map->entries[*iterator];
+      if (entry->value != NULL) {
+         (*iterator)++;
+         if (key != NULL)
+            *key = entry->key;
+         return entry->value;
+      }
+   }
+   return NULL;
+}
@@ -0,0 +1,77 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _BASE_HASHMAP_H_
+#define _BASE_HASHMAP_H_
+
+#include "base/types.h"
+
+typedef struct HashMapEntry {
+   U64 key;
+   void *value; /// NULL marks an empty slot.
+} HashMapEntry;
+
+/// Open addressing hash map from a 64-bit key to a non-NULL pointer.
+///
+/// Collisions are resolved with linear probing and removals shift the
+/// following entries back, so there are no tombstones and lookups stay short
+/// no matter how many inserts and removals have happened. The most recent
+/// successful lookup is cached since callers tend to hit the same key many
+/// times in a row.
+typedef struct HashMap {
+   HashMapEntry *entries;
+   U32 capacity;  /// Always a power of two.
+   U32 count;     /// Number of entries in use.
+   U64 lastKey;   /// Key of the last successful lookup.
+   void *lastValue; /// Value of the last successful lookup, or NULL.
+} HashMap;
+
+/// Initializes an empty hash map.
+/// @param map The map to initialize.
+/// @param initialCapacity The number of entries to reserve up front.
+void initHashMap(HashMap *map, U32 initialCapacity);
+
+/// Frees the storage owned by the map. The values are not touched.
+/// @param map The map to free.
+void freeHashMap(HashMap *map);
+
+/// Looks up a key.
+/// @param map The map to search.
+/// @param key The key to find.
+/// @return The value stored for key, or NULL if there isn't one.
+void* hashMapGet(HashMap *map, U64 key);
+
+/// Inserts or replaces the value for a key.
+/// @param map The map to insert into.
+/// @param key The key to store the value under.
+/// @param value The value to store. Must not be NULL.
+void hashMapInsert(HashMap *map, U64 key, void *value);
+
+/// Removes a key from the map.
+/// @param map The map to remove from.
+/// @param key The key to remove.
+/// @return The value that was stored for key, or NULL if there wasn't one.
+void* hashMapRemove(HashMap *map, U64 key);
+
+/// Iterates over every entry in the map. Start with *iterator set to 0.
+/// The map must not be modified while iterating.
+/// @param map The map to iterate over.
+/// @param iterator The iteration state.
+/// @param key Optional output for the key of the entry.
+/// @return The value of the next entry, or NULL when iteration is complete.
+void* hashMapNext(const HashMap *map, U32 *iterator, U64 *key);
+
+#endif
@@ -0,0 +1,87 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base/pool.h"
+
+void initPool(Pool *pool, WordSize blockSize, U32 blocksPerSlab) {
+   assert(blockSize > 0);
+   assert(blocksPerSlab > 0);
+
+   memset(pool, 0, sizeof(Pool));
+
+   // Every block has to be able to hold the free list link and keep the
+   // blocks after it aligned.
+   WordSize align = sizeof(void*) > sizeof(U64) ? sizeof(void*) : sizeof(U64);
+   pool->blockSize = (blockSize + align - 1) & ~(align - 1);
+   pool->blocksPerSlab = blocksPerSlab;
+}
+
+void freePool(Pool *pool) {
+   for (U32 i = 0; i < pool->slabCount; ++i)
+      free(pool->slabs[i]);
+   free(pool->slabs);
+
+   WordSize blockSize = pool->blockSize;
+   U32 blocksPerSlab = pool->blocksPerSlab;
+   memset(pool, 0, sizeof(Pool));
+   pool->blockSize = blockSize;
+   pool->blocksPerSlab = blocksPerSlab;
+}
+
+static void addPoolSlab(Pool *pool) {
+   if (pool->slabCount == pool->slabCapacity) {
+      pool->slabCapacity = pool->slabCapacity == 0 ? 8 : pool->slabCapacity * 2;
+      pool->slabs = (U8**)realloc(pool->slabs, sizeof(U8*) * pool->slabCapacity);
+   }
+
+   U8 *slab = (U8*)malloc(pool->blockSize * pool->blocksPerSlab);
+   pool->slabs[pool->slabCount++] = slab;
+   pool->bump = slab;
+   pool->bumpRemaining = pool->blocksPerSlab;
+}
+
+void* poolAlloc(Pool *pool) {
+   assert(pool->blockSize > 0);
+
+   if (pool->freeList != NULL) {
+      void *block = pool->freeList;
+      pool->freeList = *(void**)block;
+      poolStatsAlloc(&pool->stats, true);
+      return block;
+   }
+
+   if (pool->bumpRemaining == 0)
+      addPoolSlab(pool);
+
+   void *block = pool->bump;
+   pool->bump += pool->blockSize;
+   pool->bumpRemaining--;
+   poolStatsAlloc(&pool->stats, false);
+   return block;
+}
+
+void poolFree(Pool *pool, void *block) {
+   if (block == NULL)
+      return;
+
+   assert(pool->stats.liveCount > 0);
+   *(void**)block = pool->freeList;
+   pool->freeList = block;
+   pool->stats.liveCount--;
+}
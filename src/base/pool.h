@@ -0,0 +1,95 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _BASE_POOL_H_
+#define _BASE_POOL_H_
+
+#include "base/types.h"
+
+typedef struct PoolStats {
+   U32 liveCount;     /// Blocks currently handed out.
+   U32 highWaterMark; /// The highest liveCount has ever been.
+   U64 allocCount;    /// Total number of allocations.
+   U64 reuseCount;    /// Allocations that were served by a previously freed block.
+} PoolStats;
+
+/// Fixed size block allocator.
+///
+/// Blocks are carved out of large slabs that are only returned to the system
+/// when the pool is freed. Freed blocks are kept on an intrusive free list,
+/// so both allocating and freeing are O(1) and memory usage never goes past
+/// the high water mark no matter how many blocks come and go.
+typedef struct Pool {
+   WordSize blockSize; /// Size of every block, rounded up to pointer alignment.
+   U32 blocksPerSlab;  /// Number of blocks carved out of each slab.
+   void *freeList;     /// Freed blocks. The first word of each is the next one.
+   U8 *bump;           /// The next never used block of the newest slab.
+   U32 bumpRemaining;  /// Never used blocks left in the newest slab.
+   U8 **slabs;         /// Every slab owned by the pool.
+   U32 slabCount;
+   U32 slabCapacity;
+   PoolStats stats;
+} Pool;
+
+/// Initializes an empty pool. No memory is allocated until the first block
+/// is requested.
+/// @param pool The pool to initialize.
+/// @param blockSize The size of each block in bytes.
+/// @param blocksPerSlab The number of blocks to allocate from the system at once.
+void initPool(Pool *pool, WordSize blockSize, U32 blocksPerSlab);
+
+/// Frees every slab owned by the pool. Blocks still handed out become invalid.
+/// @param pool The pool to free.
+void freePool(Pool *pool);
+
+/// Allocates a block. The contents are undefined.
+/// @param pool The pool to allocate from.
+/// @return A block of pool->blockSize bytes.
+void* poolAlloc(Pool *pool);
+
+/// Returns a block to the pool.
+/// @param pool The pool the block was allocated from.
+/// @param block The block to free. May be NULL.
+void poolFree(Pool *pool, void *block);
+
+/// Records an allocation in a set of stats.
+/// @param stats The stats to update.
+/// @param reused Whether the allocation was served by a previously freed block.
+static inline void poolStatsAlloc(PoolStats *stats, bool reused) {
+   stats->liveCount++;
+   stats->allocCount++;
+   if (reused)
+      stats->reuseCount++;
+   if (stats->liveCount > stats->highWaterMark)
+      stats->highWaterMark = stats->liveCount;
+}
+
+/// Adds the stats of b onto a.
+static inline void poolStatsAdd(PoolStats *a, const PoolStats *b) {
+   a->liveCount += b->liveCount;
+   a->highWaterMark += b->highWaterMark;
+   a->allocCount += b->allocCount;
+   a->reuseCount += b->reuseCount;
+}
+
+/// @return The fraction of allocations that reused a freed block [0, 1].
+static inline F64 getPoolReuseRate(const PoolStats *stats) {
+   if (stats->allocCount == 0)
+      return 0.0;
+   return (F64)stats->reuseCount / (F64)stats->allocCount;
+}
+
+#endif
@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _BENCH_BENCH_H_
+#define _BENCH_BENCH_H_
+
+#include <time.h>
+#include "base/types.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+/// Returns the processor time in seconds. Benchmarks are single threaded so
+/// this is good enough and doesn't need the platform layer.
+static inline F64 benchTime() {
+   return (F64)clock() / (F64)CLOCKS_PER_SEC;
+}
+
+/// Returns the wall clock time in seconds, for benchmarks that run on more
+/// than one thread.
+static inline F64 benchWallTime() {
+#ifdef _WIN32
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER counter;
+   QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+   return (F64)counter.QuadPart / (F64)frequency.QuadPart;
+#else
+   struct timeval time;
+   gettimeofday(&time, NULL);
+   return (F64)time.tv_sec + (F64)time.tv_usec * 1.0e-6;
+#endif
+}
+
+/// Prints a single benchmark result line.
+/// @param suite The name of the benchmark suite.
+/// @param name The name of the measured operation.
+/// @param seconds The total time the operation took.
+/// @param operations The number of operations performed in that time.
+static inline void benchReport(const char *suite, const char *name, F64 seconds, F64 operations) {
+   printf("%-10s %-32s %10.3f ms %10.2f ns/op\n", suite, name, seconds * 1000.0, (seconds * 1.0e9) / operations);
+}
+
+void runSectionBenchmarks();
+void runChunkMapBenchmarks();
+void runLayoutBenchmarks();
+void runDimensionBenchmarks();
+void runPipelineBenchmarks();
+void runTerrainBenchmarks();
+void runCaveBenchmarks();
+void runMeshBenchmarks();
+void runNoiseBenchmarks();
+
+#endif
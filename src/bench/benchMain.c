@@ -0,0 +1,44 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <string.h>
+#include "bench/bench.h"
+
+int main(int argc, char **argv) {
+   // Run everything by default, or just the suite that was asked for.
+   const char *suite = argc > 1 ? argv[1] : NULL;
+
+   if (suite == NULL || strcmp(suite, "section") == 0)
+      runSectionBenchmarks();
+   if (suite == NULL || strcmp(suite, "chunkmap") == 0)
+      runChunkMapBenchmarks();
+   if (suite == NULL || strcmp(suite, "layout") == 0)
+      runLayoutBenchmarks();
+   if (suite == NULL || strcmp(suite, "dimension") == 0)
+      runDimensionBenchmarks();
+   if (suite == NULL || strcmp(suite, "pipeline") == 0)
+      runPipelineBenchmarks();
+   if (suite == NULL || strcmp(suite, "terrain") == 0)
+      runTerrainBenchmarks();
+   if (suite == NULL || strcmp(suite, "cave") == 0)
+      runCaveBenchmarks();
+   if (suite == NULL || strcmp(suite, "mesh") == 0)
+      runMeshBenchmarks();
+   if (suite == NULL || strcmp(suite, "noise") == 0)
+      runNoiseBenchmarks();
+
+   return 0;
+}
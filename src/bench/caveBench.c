@@ -0,0 +1,125 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench/bench.h"
+#include "game/chunk.h"
+#include "game/worldGen.h"
+
+// Carves the same block of chunks with every cave lattice step and compares
+// the result against sampling the noise at every cube. A step of 4 does 64
+// times fewer noise samples, the report shows what that costs in accuracy.
+
+#define CAVE_BENCH_WIDTH 6
+#define CAVE_BENCH_HEIGHT 8
+#define CAVE_BENCH_CHUNKS (CAVE_BENCH_WIDTH * CAVE_BENCH_WIDTH * CAVE_BENCH_HEIGHT)
+
+static const S32 gCaveBenchSteps[] = { 1, 2, 4, 8 };
+
+// Generates the terrain of every chunk and carves it, returning the time
+// spent carving.
+static F64 carveCaveBenchChunks(Chunk *chunks) {
+   initHashMap(&gChunkMap, CAVE_BENCH_CHUNKS);
+   initHashMap(&gChunkColumnMap, CAVE_BENCH_WIDTH * CAVE_BENCH_WIDTH);
+   for (S32 i = 0; i < CAVE_BENCH_CHUNKS; ++i) {
+      Chunk *chunk = &chunks[i];
+      memset(chunk, 0, sizeof(Chunk));
+      chunk->startX = i / (CAVE_BENCH_WIDTH * CAVE_BENCH_HEIGHT);
+      chunk->startY = i % CAVE_BENCH_HEIGHT;
+      chunk->startZ = (i / CAVE_BENCH_HEIGHT) % CAVE_BENCH_WIDTH;
+      chunk->loaded = true;
+      insertChunk(chunk);
+   }
+   for (S32 i = 0; i < CAVE_BENCH_CHUNKS; ++i)
+      generateWorld(&chunks[i]);
+
+   F64 start = benchTime();
+   for (S32 i = 0; i < CAVE_BENCH_CHUNKS; ++i)
+      generateCaves(&chunks[i]);
+   F64 time = benchTime() - start;
+
+   for (S32 i = 0; i < CAVE_BENCH_CHUNKS; ++i)
+      freeCaveDensity(&chunks[i]);
+   return time;
+}
+
+static void freeCaveBenchChunks(Chunk *chunks) {
+   for (S32 i = 0; i < CAVE_BENCH_CHUNKS; ++i) {
+      removeChunk(&chunks[i]);
+      freeChunkSection(&chunks[i].section);
+   }
+   freeHashMap(&gChunkMap);
+   freeHashMap(&gChunkColumnMap);
+}
+
+void runCaveBenchmarks() {
+   const char *suite = "cave";
+   const S32 cubeCount = CAVE_BENCH_CHUNKS * CHUNK_SIZE;
+
+   initWorldGen((U64)0xDEADBEEF);
+   initChunkSectionPools();
+
+   Chunk *chunks = (Chunk*)calloc(CAVE_BENCH_CHUNKS, sizeof(Chunk));
+   U8 *reference = (U8*)malloc(cubeCount);
+   S32 referenceCarved = 0;
+   S32 oldStep = getCaveLatticeStep();
+
+   for (U32 s = 0; s < sizeof(gCaveBenchSteps) / sizeof(gCaveBenchSteps[0]); ++s) {
+      S32 step = gCaveBenchSteps[s];
+      setCaveLatticeStep(step);
+
+      // Caves are the only air below the surface, trees aren't planted.
+      F64 time = carveCaveBenchChunks(chunks);
+      S32 terrainSolid = 0;
+      S32 carved = 0;
+      S32 differ = 0;
+      for (S32 i = 0; i < CAVE_BENCH_CHUNKS; ++i) {
+         Chunk *chunk = &chunks[i];
+         for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+            for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+               S32 surface = getTerrainHeight(chunk->startX * CHUNK_WIDTH + x, chunk->startZ * CHUNK_WIDTH + z) - chunk->startY * CHUNK_HEIGHT;
+               for (S32 y = 0; y < CHUNK_HEIGHT; ++y) {
+                  S32 index = ((i * CHUNK_WIDTH + x) * CHUNK_WIDTH + z) * CHUNK_HEIGHT + y;
+                  U8 air = y <= surface && isTransparent(chunk, x, y, z);
+                  terrainSolid += y <= surface;
+                  carved += air;
+                  if (step == 1)
+                     reference[index] = air;
+                  else
+                     differ += air != reference[index];
+               }
+            }
+         }
+      }
+      if (step == 1)
+         referenceCarved = carved;
+      freeCaveBenchChunks(chunks);
+
+      char name[64];
+      snprintf(name, sizeof(name), "step %d carve (per chunk)", step);
+      benchReport(suite, name, time, (F64)CAVE_BENCH_CHUNKS);
+      printf("%-10s step %d: %d of %d cubes carved (%.1f%% of full resolution), %.2f%% of terrain differs\n", suite, step,
+         carved, terrainSolid, referenceCarved > 0 ? (F64)carved * 100.0 / (F64)referenceCarved : 0.0, (F64)differ * 100.0 / (F64)terrainSolid);
+   }
+
+   setCaveLatticeStep(oldStep);
+   free(reference);
+   free(chunks);
+   freeChunkSectionPools();
+   freeWorldGen();
+}
@@ -0,0 +1,90 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include "base/hashMap.h"
+#include "bench/bench.h"
+
+// Measures chunk lookups as the number of loaded chunks grows. Lookup cost
+// should stay flat from a few hundred chunks up to tens of thousands.
+
+#define CHUNK_MAP_BENCH_LOOKUPS (1 << 22)
+
+static inline U64 getBenchChunkKey(S32 x, S32 z) {
+   return ((U64)(U32)x << 32) | (U64)(U32)z;
+}
+
+static inline U32 nextRandom(U32 *state) {
+   *state = *state * 1664525U + 1013904223U;
+   return *state >> 8;
+}
+
+static volatile WordSize gSink;
+
+static void benchChunkMap(S32 radius) {
+   S32 side = radius * 2;
+   S32 count = side * side;
+   char name[64];
+
+   // Values only have to be non-NULL, so point them into a dummy array.
+   U8 *values = (U8*)calloc(count, 1);
+
+   HashMap map;
+   initHashMap(&map, 16);
+
+   F64 start = benchTime();
+   for (S32 i = 0; i < count; ++i)
+      hashMapInsert(&map, getBenchChunkKey((i % side) - radius, (i / side) - radius), &values[i]);
+   snprintf(name, sizeof(name), "insert (%d chunks)", count);
+   benchReport("chunkmap", name, benchTime() - start, (F64)count);
+
+   WordSize sum = 0;
+   U32 seed = 1;
+   start = benchTime();
+   for (S32 i = 0; i < CHUNK_MAP_BENCH_LOOKUPS; ++i) {
+      U32 r = nextRandom(&seed) % (U32)count;
+      sum += (WordSize)hashMapGet(&map, getBenchChunkKey((S32)(r % side) - radius, (S32)(r / side) - radius));
+   }
+   snprintf(name, sizeof(name), "random hit (%d chunks)", count);
+   benchReport("chunkmap", name, benchTime() - start, (F64)CHUNK_MAP_BENCH_LOOKUPS);
+
+   // The access pattern of meshing and cave carving: the same chunk over
+   // and over, which the last lookup cache serves.
+   start = benchTime();
+   for (S32 i = 0; i < CHUNK_MAP_BENCH_LOOKUPS; ++i)
+      sum += (WordSize)hashMapGet(&map, getBenchChunkKey((i >> 12) % radius, 0));
+   snprintf(name, sizeof(name), "repeated hit (%d chunks)", count);
+   benchReport("chunkmap", name, benchTime() - start, (F64)CHUNK_MAP_BENCH_LOOKUPS);
+
+   start = benchTime();
+   for (S32 i = 0; i < CHUNK_MAP_BENCH_LOOKUPS; ++i) {
+      U32 r = nextRandom(&seed);
+      sum += (WordSize)hashMapGet(&map, getBenchChunkKey(radius + (S32)(r & 0xFFFF), (S32)(r >> 16)));
+   }
+   snprintf(name, sizeof(name), "miss (%d chunks)", count);
+   benchReport("chunkmap", name, benchTime() - start, (F64)CHUNK_MAP_BENCH_LOOKUPS);
+
+   freeHashMap(&map);
+   free(values);
+   gSink = sum;
+}
+
+void runChunkMapBenchmarks() {
+   benchChunkMap(8);
+   benchChunkMap(32);
+   benchChunkMap(64);
+   benchChunkMap(128);
+}
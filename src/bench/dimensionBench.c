@@ -0,0 +1,222 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench/bench.h"
+#include "game/blockCursor.h"
+#include "game/chunk.h"
+#include "game/chunkPipeline.h"
+#include "game/mesher.h"
+#include "game/worldGen.h"
+
+// Generates and meshes the same block of the world whatever the chunk
+// dimensions are. Compare the JeefCraftBench<width>x<height> builds: bigger
+// chunks mean fewer draw calls but every edit remeshes more cubes.
+
+#define DIMENSION_BENCH_WIDTH 128
+#define DIMENSION_BENCH_HEIGHT 128
+#define DIMENSION_BENCH_CHUNKS_XZ (DIMENSION_BENCH_WIDTH / CHUNK_WIDTH)
+#define DIMENSION_BENCH_CHUNKS_Y (DIMENSION_BENCH_HEIGHT / CHUNK_HEIGHT)
+#define DIMENSION_BENCH_CHUNKS (DIMENSION_BENCH_CHUNKS_XZ * DIMENSION_BENCH_CHUNKS_XZ * DIMENSION_BENCH_CHUNKS_Y)
+#define DIMENSION_BENCH_EDITS 256
+
+static inline U32 nextRandom(U32 *state) {
+   *state = *state * 1664525U + 1013904223U;
+   return *state >> 8;
+}
+
+static inline WordSize getRenderChunkMemoryUsage(const RenderChunk *renderChunk) {
+   return (WordSize)renderChunk->vertexCount * sizeof(GPUVertex);
+}
+
+static void freeBenchGeometry(Chunk *chunk) {
+   freeRenderChunkGeometry(&chunk->renderChunk);
+   memset(&chunk->renderChunk, 0, sizeof(RenderChunk));
+}
+
+// Remeshes a chunk right away, minus the upload. Returns the number of
+// chunks remeshed.
+static S32 remeshBenchChunk(Chunk *chunk) {
+   if (chunk == NULL)
+      return 0;
+
+   freeBenchGeometry(chunk);
+   generateGeometry(chunk);
+   return 1;
+}
+
+// Digs out the top cube of random columns. Positions are picked up front
+// so that only the edits and the remeshes are timed.
+static void pickBenchEdits(BlockCursor *edits, U32 *seed) {
+   for (S32 i = 0; i < DIMENSION_BENCH_EDITS; ++i) {
+      U32 r = nextRandom(seed);
+      S32 x = (S32)(r % DIMENSION_BENCH_WIDTH);
+      S32 z = (S32)((r >> 12) % DIMENSION_BENCH_WIDTH);
+      S32 y = DIMENSION_BENCH_HEIGHT - 1;
+      initBlockCursor(&edits[i], x, y, z);
+      while (y > 0 && isBlockCursorTransparent(&edits[i])) {
+         stepYNeg(&edits[i]);
+         --y;
+      }
+   }
+}
+
+// Flags the chunk of an edit and the neighbours it borders, like
+// removeCubeAtWorldPosition does.
+static void markBenchEditDirty(const BlockCursor *cursor) {
+   Chunk *chunk = cursor->chunk;
+   markChunkDirty(chunk);
+
+   if (cursor->x == 0)
+      markChunkDirty(chunk->neighbours[ChunkNeighbour_NegativeX]);
+   else if (cursor->x >= (CHUNK_WIDTH - 1))
+      markChunkDirty(chunk->neighbours[ChunkNeighbour_PositiveX]);
+
+   if (cursor->y == 0)
+      markChunkDirty(chunk->neighbours[ChunkNeighbour_NegativeY]);
+   else if (cursor->y >= (CHUNK_HEIGHT - 1))
+      markChunkDirty(chunk->neighbours[ChunkNeighbour_PositiveY]);
+
+   if (cursor->z == 0)
+      markChunkDirty(chunk->neighbours[ChunkNeighbour_NegativeZ]);
+   else if (cursor->z >= (CHUNK_WIDTH - 1))
+      markChunkDirty(chunk->neighbours[ChunkNeighbour_PositiveZ]);
+}
+
+void runDimensionBenchmarks() {
+   char suite[16];
+   snprintf(suite, sizeof(suite), "%dx%d", CHUNK_WIDTH, CHUNK_HEIGHT);
+
+   initWorldGen((U64)0xDEADBEEF);
+   initChunkSectionPools();
+   initMeshScratch();
+   initHashMap(&gChunkMap, DIMENSION_BENCH_CHUNKS);
+   initHashMap(&gChunkColumnMap, DIMENSION_BENCH_CHUNKS_XZ * DIMENSION_BENCH_CHUNKS_XZ);
+
+   // Chunks are stored x, z, y so every pass below runs in the same order as
+   // the world does.
+   Chunk *chunks = (Chunk*)calloc(DIMENSION_BENCH_CHUNKS, sizeof(Chunk));
+   for (S32 i = 0; i < DIMENSION_BENCH_CHUNKS; ++i) {
+      Chunk *chunk = &chunks[i];
+      chunk->startX = i / (DIMENSION_BENCH_CHUNKS_XZ * DIMENSION_BENCH_CHUNKS_Y);
+      chunk->startY = i % DIMENSION_BENCH_CHUNKS_Y;
+      chunk->startZ = (i / DIMENSION_BENCH_CHUNKS_Y) % DIMENSION_BENCH_CHUNKS_XZ;
+      chunk->loaded = true;
+      insertChunk(chunk);
+   }
+
+   F64 start = benchTime();
+   for (S32 i = 0; i < DIMENSION_BENCH_CHUNKS; ++i)
+      generateWorld(&chunks[i]);
+   for (S32 i = 0; i < DIMENSION_BENCH_CHUNKS; ++i)
+      generateCaves(&chunks[i]);
+   for (S32 i = 0; i < DIMENSION_BENCH_CHUNKS; ++i)
+      generateStructures(&chunks[i]);
+   benchReport(suite, "generate (per column)", benchTime() - start, (F64)(DIMENSION_BENCH_WIDTH * DIMENSION_BENCH_WIDTH));
+
+   // Every chunk with geometry is one draw call.
+   start = benchTime();
+   for (S32 i = 0; i < DIMENSION_BENCH_CHUNKS; ++i)
+      generateGeometry(&chunks[i]);
+   benchReport(suite, "mesh (per column)", benchTime() - start, (F64)(DIMENSION_BENCH_WIDTH * DIMENSION_BENCH_WIDTH));
+
+   S32 drawCalls = 0;
+   WordSize meshMemory = 0;
+   WordSize cubeMemory = 0;
+   for (S32 i = 0; i < DIMENSION_BENCH_CHUNKS; ++i) {
+      if (chunks[i].renderChunk.vertexCount > 0)
+         drawCalls++;
+      meshMemory += getRenderChunkMemoryUsage(&chunks[i].renderChunk);
+      cubeMemory += getChunkSectionMemoryUsage(&chunks[i].section);
+      freeBenchGeometry(&chunks[i]);
+   }
+
+   // One edit at a time, each remeshing its chunk and the neighbours it
+   // borders straight away.
+   BlockCursor edits[DIMENSION_BENCH_EDITS];
+   U32 seed = 1;
+   pickBenchEdits(edits, &seed);
+
+   S32 remeshCount = 0;
+   start = benchTime();
+   for (S32 i = 0; i < DIMENSION_BENCH_EDITS; ++i) {
+      BlockCursor *cursor = &edits[i];
+      Chunk *chunk = cursor->chunk;
+      setBlockCursorCube(cursor, Material_Air);
+      remeshCount += remeshBenchChunk(chunk);
+
+      if (cursor->x == 0)
+         remeshCount += remeshBenchChunk(chunk->neighbours[ChunkNeighbour_NegativeX]);
+      else if (cursor->x >= (CHUNK_WIDTH - 1))
+         remeshCount += remeshBenchChunk(chunk->neighbours[ChunkNeighbour_PositiveX]);
+
+      if (cursor->y == 0)
+         remeshCount += remeshBenchChunk(chunk->neighbours[ChunkNeighbour_NegativeY]);
+      else if (cursor->y >= (CHUNK_HEIGHT - 1))
+         remeshCount += remeshBenchChunk(chunk->neighbours[ChunkNeighbour_PositiveY]);
+
+      if (cursor->z == 0)
+         remeshCount += remeshBenchChunk(chunk->neighbours[ChunkNeighbour_NegativeZ]);
+      else if (cursor->z >= (CHUNK_WIDTH - 1))
+         remeshCount += remeshBenchChunk(chunk->neighbours[ChunkNeighbour_PositiveZ]);
+   }
+   benchReport(suite, "edit and remesh (per edit)", benchTime() - start, (F64)DIMENSION_BENCH_EDITS);
+
+   // The same number of edits as one batch, the way the world makes them:
+   // every chunk is remeshed once by the pipeline however often it was
+   // edited. The chunks were meshed above, so they start out finished with
+   // their meshes uploaded.
+   for (S32 i = 0; i < DIMENSION_BENCH_CHUNKS; ++i) {
+      freeBenchGeometry(&chunks[i]);
+      chunks[i].status = ChunkStatus_Meshed;
+   }
+   initChunkPipeline(0);
+   pickBenchEdits(edits, &seed);
+
+   start = benchTime();
+   beginWorldEdit();
+   for (S32 i = 0; i < DIMENSION_BENCH_EDITS; ++i) {
+      setBlockCursorCube(&edits[i], Material_Air);
+      markBenchEditDirty(&edits[i]);
+   }
+   S32 bulkRemeshCount = flushWorldEdits();
+   waitForChunkPipeline();
+   benchReport(suite, "bulk edit and remesh (per edit)", benchTime() - start, (F64)DIMENSION_BENCH_EDITS);
+
+   Chunk *finished[DIMENSION_BENCH_CHUNKS];
+   S32 finishedCount = collectFinishedChunks(finished, DIMENSION_BENCH_CHUNKS);
+   for (S32 i = 0; i < finishedCount; ++i)
+      freeBenchGeometry(finished[i]);
+   freeChunkPipeline();
+
+   printf("%-10s chunks: %d, draw calls: %d\n", suite, DIMENSION_BENCH_CHUNKS, drawCalls);
+   printf("%-10s %d edits: %d remeshes one at a time, %d in a batch\n", suite, DIMENSION_BENCH_EDITS, remeshCount, bulkRemeshCount);
+   printf("%-10s memory: %lu KB cubes, %lu KB mesh, %lu KB chunks\n", suite,
+      (unsigned long)(cubeMemory / 1024), (unsigned long)(meshMemory / 1024), (unsigned long)(DIMENSION_BENCH_CHUNKS * sizeof(Chunk) / 1024));
+
+   for (S32 i = 0; i < DIMENSION_BENCH_CHUNKS; ++i) {
+      freeBenchGeometry(&chunks[i]);
+      freeChunkSection(&chunks[i].section);
+   }
+   free(chunks);
+   freeHashMap(&gChunkMap);
+   freeHashMap(&gChunkColumnMap);
+   freeChunkSectionPools();
+   freeMeshScratch();
+   freeWorldGen();
+}
@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "bench/bench.h"
+#include "game/chunk.h"
+#include "game/mesher.h"
+#include "game/worldGen.h"
+
+// Runs the real world generator and mesher over a block of chunks. The
+// numbers only mean something compared against a build using a different
+// CHUNK_LAYOUT, so every build reports under the name of its layout.
+
+#define LAYOUT_BENCH_WIDTH 6
+#define LAYOUT_BENCH_HEIGHT 8
+#define LAYOUT_BENCH_CHUNKS (LAYOUT_BENCH_WIDTH * LAYOUT_BENCH_WIDTH * LAYOUT_BENCH_HEIGHT)
+#define LAYOUT_BENCH_RANDOM_OPS (1 << 22)
+
+static inline U32 nextRandom(U32 *state) {
+   *state = *state * 1664525U + 1013904223U;
+   return *state >> 8;
+}
+
+static volatile U32 gSink;
+
+void runLayoutBenchmarks() {
+   const char *suite = CHUNK_LAYOUT_NAME;
+
+   initWorldGen((U64)0xDEADBEEF);
+   initChunkSectionPools();
+   initMeshScratch();
+   initHashMap(&gChunkMap, LAYOUT_BENCH_CHUNKS);
+   initHashMap(&gChunkColumnMap, LAYOUT_BENCH_WIDTH * LAYOUT_BENCH_WIDTH);
+
+   // Chunks are stored x, z, y so every pass below runs in the same order as
+   // the world does.
+   Chunk *chunks = (Chunk*)calloc(LAYOUT_BENCH_CHUNKS, sizeof(Chunk));
+   for (S32 i = 0; i < LAYOUT_BENCH_CHUNKS; ++i) {
+      Chunk *chunk = &chunks[i];
+      chunk->startX = i / (LAYOUT_BENCH_WIDTH * LAYOUT_BENCH_HEIGHT);
+      chunk->startY = i % LAYOUT_BENCH_HEIGHT;
+      chunk->startZ = (i / LAYOUT_BENCH_HEIGHT) % LAYOUT_BENCH_WIDTH;
+      chunk->loaded = true;
+      insertChunk(chunk);
+   }
+
+   F64 start = benchTime();
+   for (S32 i = 0; i < LAYOUT_BENCH_CHUNKS; ++i)
+      generateWorld(&chunks[i]);
+   benchReport(suite, "generate terrain (per chunk)", benchTime() - start, (F64)LAYOUT_BENCH_CHUNKS);
+
+   start = benchTime();
+   for (S32 i = 0; i < LAYOUT_BENCH_CHUNKS; ++i)
+      generateCaves(&chunks[i]);
+   for (S32 i = 0; i < LAYOUT_BENCH_CHUNKS; ++i)
+      generateStructures(&chunks[i]);
+   benchReport(suite, "generate caves (per chunk)", benchTime() - start, (F64)LAYOUT_BENCH_CHUNKS);
+
+   start = benchTime();
+   for (S32 i = 0; i < LAYOUT_BENCH_CHUNKS; ++i) {
+      generateGeometry(&chunks[i]);
+      freeRenderChunkGeometry(&chunks[i].renderChunk);
+      memset(&chunks[i].renderChunk, 0, sizeof(RenderChunk));
+   }
+   benchReport(suite, "mesh (per chunk)", benchTime() - start, (F64)LAYOUT_BENCH_CHUNKS);
+   printf("%-10s mesh scratch: %.1f%% reused\n", suite, getPoolReuseRate(getMeshScratchStats()) * 100.0);
+
+   // Sum the 6 neighbours of every cube inside of a chunk, the access
+   // pattern of face culling and cave smoothing.
+   U32 sum = 0;
+   start = benchTime();
+   for (S32 i = 0; i < LAYOUT_BENCH_CHUNKS; ++i) {
+      Chunk *chunk = &chunks[i];
+      for (S32 x = 1; x < CHUNK_WIDTH - 1; ++x) {
+         for (S32 z = 1; z < CHUNK_WIDTH - 1; ++z) {
+            for (S32 y = 1; y < CHUNK_HEIGHT - 1; ++y) {
+               sum += isTransparent(chunk, x - 1, y, z) + isTransparent(chunk, x + 1, y, z);
+               sum += isTransparent(chunk, x, y - 1, z) + isTransparent(chunk, x, y + 1, z);
+               sum += isTransparent(chunk, x, y, z - 1) + isTransparent(chunk, x, y, z + 1);
+            }
+         }
+      }
+   }
+   benchReport(suite, "6-neighbour read (per cube)", benchTime() - start, (F64)LAYOUT_BENCH_CHUNKS * (CHUNK_WIDTH - 2) * (CHUNK_WIDTH - 2) * (CHUNK_HEIGHT - 2));
+
+   U32 seed = 1;
+   start = benchTime();
+   for (S32 i = 0; i < LAYOUT_BENCH_RANDOM_OPS; ++i) {
+      U32 r = nextRandom(&seed);
+      Chunk *chunk = &chunks[r % LAYOUT_BENCH_CHUNKS];
+      sum += getCubeAt(chunk, (r >> 6) % CHUNK_WIDTH, (r >> 10) % CHUNK_HEIGHT, (r >> 18) % CHUNK_WIDTH).material;
+   }
+   benchReport(suite, "random read", benchTime() - start, (F64)LAYOUT_BENCH_RANDOM_OPS);
+
+   for (S32 i = 0; i < LAYOUT_BENCH_CHUNKS; ++i)
+      freeChunkSection(&chunks[i].section);
+   free(chunks);
+   freeHashMap(&gChunkMap);
+   freeHashMap(&gChunkColumnMap);
+   freeChunkSectionPools();
+   freeMeshScratch();
+   freeWorldGen();
+   gSink = sum;
+}
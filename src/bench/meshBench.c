@@ -0,0 +1,128 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench/bench.h"
+#include "game/chunk.h"
+#include "game/mesher.h"
+#include "game/worldGen.h"
+
+// Meshes the same block of generated chunks with one face per cube side and
+// with greedy meshing. Both have to cover exactly the same cube faces, the
+// report shows how much smaller the greedy mesh is and what it costs.
+
+#define MESH_BENCH_WIDTH 6
+#define MESH_BENCH_HEIGHT 8
+#define MESH_BENCH_CHUNKS (MESH_BENCH_WIDTH * MESH_BENCH_WIDTH * MESH_BENCH_HEIGHT)
+
+/// Each chunk is meshed this many times so the timings aren't too short.
+#define MESH_BENCH_REPEAT 4
+
+typedef struct MeshBenchResult {
+   F64 seconds;
+   U32 vertexCount;
+   U32 faceCount;    /// Cube faces covered, a merged quad counts every face under it.
+   U64 remeshCount;  /// Timed meshes that had any faces.
+   U64 heapCount;    /// Timed meshes whose scratch buffer came from the heap.
+} MeshBenchResult;
+
+// Meshes every chunk and throws the geometry away again.
+static void meshBenchChunks(Chunk *chunks, bool greedy, MeshBenchResult *result) {
+   setGreedyMeshing(greedy);
+   memset(result, 0, sizeof(MeshBenchResult));
+
+   PoolStats before = *getMeshScratchStats();
+   F64 start = benchTime();
+   for (S32 r = 0; r < MESH_BENCH_REPEAT; ++r) {
+      for (S32 i = 0; i < MESH_BENCH_CHUNKS; ++i) {
+         generateGeometry(&chunks[i]);
+         freeRenderChunkGeometry(&chunks[i].renderChunk);
+      }
+   }
+   result->seconds = benchTime() - start;
+   const PoolStats *after = getMeshScratchStats();
+   result->remeshCount = after->allocCount - before.allocCount;
+   result->heapCount = result->remeshCount - (after->reuseCount - before.reuseCount);
+
+   for (S32 i = 0; i < MESH_BENCH_CHUNKS; ++i) {
+      RenderChunk *renderChunk = &chunks[i].renderChunk;
+      generateGeometry(&chunks[i]);
+      result->vertexCount += renderChunk->vertexCount;
+
+      // The uvs run in cubes, so opposite corners of a quad span its size.
+      for (S32 v = 0; v < renderChunk->vertexCount; v += QUAD_VERTEX_COUNT) {
+         const GPUVertex *quad = &renderChunk->vertexData[v];
+         result->faceCount += (U32)(abs(quad[2].u - quad[0].u) * abs(quad[2].v - quad[0].v));
+      }
+      freeRenderChunkGeometry(renderChunk);
+   }
+}
+
+void runMeshBenchmarks() {
+   const char *suite = "mesh";
+
+   initWorldGen((U64)0xDEADBEEF);
+   initChunkSectionPools();
+   initMeshScratch();
+   initHashMap(&gChunkMap, MESH_BENCH_CHUNKS);
+   initHashMap(&gChunkColumnMap, MESH_BENCH_WIDTH * MESH_BENCH_WIDTH);
+
+   Chunk *chunks = (Chunk*)calloc(MESH_BENCH_CHUNKS, sizeof(Chunk));
+   for (S32 i = 0; i < MESH_BENCH_CHUNKS; ++i) {
+      Chunk *chunk = &chunks[i];
+      chunk->startX = i / (MESH_BENCH_WIDTH * MESH_BENCH_HEIGHT);
+      chunk->startY = i % MESH_BENCH_HEIGHT;
+      chunk->startZ = (i / MESH_BENCH_HEIGHT) % MESH_BENCH_WIDTH;
+      chunk->loaded = true;
+      insertChunk(chunk);
+   }
+   for (S32 i = 0; i < MESH_BENCH_CHUNKS; ++i)
+      generateWorld(&chunks[i]);
+   for (S32 i = 0; i < MESH_BENCH_CHUNKS; ++i)
+      generateCaves(&chunks[i]);
+   for (S32 i = 0; i < MESH_BENCH_CHUNKS; ++i)
+      generateStructures(&chunks[i]);
+
+   bool oldGreedy = isGreedyMeshing();
+   MeshBenchResult cube;
+   MeshBenchResult greedy;
+   meshBenchChunks(chunks, false, &cube);
+   meshBenchChunks(chunks, true, &greedy);
+   setGreedyMeshing(oldGreedy);
+
+   benchReport(suite, "per cube side (per chunk)", cube.seconds, (F64)(MESH_BENCH_CHUNKS * MESH_BENCH_REPEAT));
+   benchReport(suite, "greedy (per chunk)", greedy.seconds, (F64)(MESH_BENCH_CHUNKS * MESH_BENCH_REPEAT));
+   printf("%-10s per cube side: %u vertices, %u KB\n", suite, cube.vertexCount, (U32)(cube.vertexCount * sizeof(GPUVertex) / 1024));
+   printf("%-10s greedy: %u vertices, %u KB (%.1f%%), %s faces\n", suite, greedy.vertexCount, (U32)(greedy.vertexCount * sizeof(GPUVertex) / 1024),
+      cube.vertexCount > 0 ? (F64)greedy.vertexCount * 100.0 / (F64)cube.vertexCount : 0.0,
+      greedy.faceCount == cube.faceCount ? "same" : "MISMATCHED");
+   printf("%-10s heap allocations per remesh: %.3f per cube side, %.3f greedy\n", suite,
+      cube.remeshCount > 0 ? (F64)cube.heapCount / (F64)cube.remeshCount : 0.0,
+      greedy.remeshCount > 0 ? (F64)greedy.heapCount / (F64)greedy.remeshCount : 0.0);
+
+   for (S32 i = 0; i < MESH_BENCH_CHUNKS; ++i) {
+      removeChunk(&chunks[i]);
+      freeChunkSection(&chunks[i].section);
+   }
+   free(chunks);
+   freeHashMap(&gChunkMap);
+   freeHashMap(&gChunkColumnMap);
+   freeMeshScratch();
+   freeChunkSectionPools();
+   freeWorldGen();
+}
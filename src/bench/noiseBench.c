@@ -0,0 +1,163 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <open-simplex-noise.h>
+#include "bench/bench.h"
+#include "math/noise.h"
+
+// Samples the same points with the library one at a time and with the
+// batches. The double batches have to match the library exactly, the float
+// ones have to stay within NOISE_BENCH_F32_EPSILON of it.
+
+#define NOISE_BENCH_POINTS 245760
+#define NOISE_BENCH_RUNS 5
+
+/// How far the coordinates reach from 0, in both directions.
+#define NOISE_BENCH_RANGE 512.0
+
+/// The largest difference allowed between the float batches and the library.
+#define NOISE_BENCH_F32_EPSILON 1.0e-3
+
+typedef struct NoiseBenchPoints {
+   F64 *x, *y, *z;
+   F32 *xf, *yf, *zf;
+   F64 *library, *batch;
+   F32 *batchF32;
+} NoiseBenchPoints;
+
+typedef enum NoiseBenchMode {
+   NOISE_BENCH_LIBRARY,
+   NOISE_BENCH_BATCH,
+   NOISE_BENCH_BATCH_F32
+} NoiseBenchMode;
+
+// Samples every point in the given mode, returning the fastest of a few
+// runs so that one slow run doesn't skew the speedup.
+static F64 sampleNoiseBenchPoints(const Noise *noise, NoiseBenchPoints *p, S32 dimensions, NoiseBenchMode mode) {
+   F64 best = 0.0;
+   for (S32 run = 0; run < NOISE_BENCH_RUNS; ++run) {
+      F64 start = benchTime();
+      for (S32 i = 0; i < NOISE_BENCH_POINTS; i += NOISE_BATCH_MAX) {
+         switch (mode) {
+         case NOISE_BENCH_LIBRARY:
+            for (S32 j = i; j < i + NOISE_BATCH_MAX; ++j) {
+               if (dimensions == 2)
+                  p->library[j] = open_simplex_noise2(noise->context, p->x[j], p->y[j]);
+               else
+                  p->library[j] = open_simplex_noise3(noise->context, p->x[j], p->y[j], p->z[j]);
+            }
+            break;
+         case NOISE_BENCH_BATCH:
+            if (dimensions == 2)
+               sampleNoise2Batch(noise, p->x + i, p->y + i, p->batch + i, NOISE_BATCH_MAX);
+            else
+               sampleNoise3Batch(noise, p->x + i, p->y + i, p->z + i, p->batch + i, NOISE_BATCH_MAX);
+            break;
+         case NOISE_BENCH_BATCH_F32:
+            if (dimensions == 2)
+               sampleNoise2BatchF32(noise, p->xf + i, p->yf + i, p->batchF32 + i, NOISE_BATCH_MAX);
+            else
+               sampleNoise3BatchF32(noise, p->xf + i, p->yf + i, p->zf + i, p->batchF32 + i, NOISE_BATCH_MAX);
+            break;
+         }
+      }
+      F64 time = benchTime() - start;
+      if (run == 0 || time < best)
+         best = time;
+   }
+   return best;
+}
+
+static void runNoiseBenchDimensions(const Noise *noise, NoiseBenchPoints *p, S32 dimensions) {
+   const char *suite = "noise";
+   char name[64];
+
+   F64 libraryTime = sampleNoiseBenchPoints(noise, p, dimensions, NOISE_BENCH_LIBRARY);
+   F64 batchTime = sampleNoiseBenchPoints(noise, p, dimensions, NOISE_BENCH_BATCH);
+   F64 batchF32Time = sampleNoiseBenchPoints(noise, p, dimensions, NOISE_BENCH_BATCH_F32);
+
+   snprintf(name, sizeof(name), "%dD library (per point)", dimensions);
+   benchReport(suite, name, libraryTime, (F64)NOISE_BENCH_POINTS);
+   snprintf(name, sizeof(name), "%dD batch (per point)", dimensions);
+   benchReport(suite, name, batchTime, (F64)NOISE_BENCH_POINTS);
+   snprintf(name, sizeof(name), "%dD float batch (per point)", dimensions);
+   benchReport(suite, name, batchF32Time, (F64)NOISE_BENCH_POINTS);
+
+   // The float batches sample the float coordinates, so they are compared
+   // with the library at those same coordinates.
+   S32 mismatches = 0;
+   S32 outside = 0;
+   F64 maxError = 0.0;
+   for (S32 i = 0; i < NOISE_BENCH_POINTS; ++i) {
+      mismatches += p->batch[i] != p->library[i];
+      F64 expected = dimensions == 2 ?
+         open_simplex_noise2(noise->context, (F64)p->xf[i], (F64)p->yf[i]) :
+         open_simplex_noise3(noise->context, (F64)p->xf[i], (F64)p->yf[i], (F64)p->zf[i]);
+      F64 error = fabs((F64)p->batchF32[i] - expected);
+      outside += error > NOISE_BENCH_F32_EPSILON;
+      if (error > maxError)
+         maxError = error;
+   }
+
+   printf("%-10s %dD: batch %.2fx, float batch %.2fx the speed of the library\n", suite, dimensions,
+      libraryTime / batchTime, libraryTime / batchF32Time);
+   printf("%-10s %dD: %d of %d batch results differ from the library\n", suite, dimensions, mismatches, NOISE_BENCH_POINTS);
+   printf("%-10s %dD: float batch differs by up to %g, %d results over %g\n", suite, dimensions, maxError, outside,
+      NOISE_BENCH_F32_EPSILON);
+}
+
+void runNoiseBenchmarks() {
+   NoiseBenchPoints p;
+   p.x = (F64*)malloc(sizeof(F64) * NOISE_BENCH_POINTS);
+   p.y = (F64*)malloc(sizeof(F64) * NOISE_BENCH_POINTS);
+   p.z = (F64*)malloc(sizeof(F64) * NOISE_BENCH_POINTS);
+   p.xf = (F32*)malloc(sizeof(F32) * NOISE_BENCH_POINTS);
+   p.yf = (F32*)malloc(sizeof(F32) * NOISE_BENCH_POINTS);
+   p.zf = (F32*)malloc(sizeof(F32) * NOISE_BENCH_POINTS);
+   p.library = (F64*)malloc(sizeof(F64) * NOISE_BENCH_POINTS);
+   p.batch = (F64*)malloc(sizeof(F64) * NOISE_BENCH_POINTS);
+   p.batchF32 = (F32*)malloc(sizeof(F32) * NOISE_BENCH_POINTS);
+
+   srand(1);
+   for (S32 i = 0; i < NOISE_BENCH_POINTS; ++i) {
+      p.x[i] = ((F64)rand() / (F64)RAND_MAX * 2.0 - 1.0) * NOISE_BENCH_RANGE;
+      p.y[i] = ((F64)rand() / (F64)RAND_MAX * 2.0 - 1.0) * NOISE_BENCH_RANGE;
+      p.z[i] = ((F64)rand() / (F64)RAND_MAX * 2.0 - 1.0) * NOISE_BENCH_RANGE;
+      p.xf[i] = (F32)p.x[i];
+      p.yf[i] = (F32)p.y[i];
+      p.zf[i] = (F32)p.z[i];
+   }
+
+   Noise noise;
+   initNoise(&noise, (S64)0xDEADBEEF);
+   printf("%-10s batches use the %s\n", "noise", noise.vectorized ? "vector kernel" : "library");
+   runNoiseBenchDimensions(&noise, &p, 2);
+   runNoiseBenchDimensions(&noise, &p, 3);
+   freeNoise(&noise);
+
+   free(p.x);
+   free(p.y);
+   free(p.z);
+   free(p.xf);
+   free(p.yf);
+   free(p.zf);
+   free(p.library);
+   free(p.batch);
+   free(p.batchF32);
+}
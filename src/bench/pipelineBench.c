@@ -0,0 +1,268 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench/bench.h"
+#include "game/chunk.h"
+#include "game/chunkPipeline.h"
+#include "game/mesher.h"
+#include "game/worldGen.h"
+#include "platform/thread.h"
+
+// Generates and meshes the same block of chunks one after another and then
+// through the pipeline with more and more worker threads. Every run has to
+// produce exactly the same cubes and geometry.
+
+#define PIPELINE_BENCH_WIDTH 8
+#define PIPELINE_BENCH_HEIGHT 8
+#define PIPELINE_BENCH_CHUNKS (PIPELINE_BENCH_WIDTH * PIPELINE_BENCH_WIDTH * PIPELINE_BENCH_HEIGHT)
+
+static U64 hashBytes(U64 hash, const void *data, WordSize size) {
+   const U8 *bytes = (const U8*)data;
+   for (WordSize i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+   }
+   return hash;
+}
+
+// Chunks are stored x, z, y, the order the world generates them in.
+static Chunk* loadBenchChunks() {
+   Chunk *chunks = (Chunk*)calloc(PIPELINE_BENCH_CHUNKS, sizeof(Chunk));
+   for (S32 i = 0; i < PIPELINE_BENCH_CHUNKS; ++i) {
+      Chunk *chunk = &chunks[i];
+      chunk->startX = i / (PIPELINE_BENCH_WIDTH * PIPELINE_BENCH_HEIGHT);
+      chunk->startY = i % PIPELINE_BENCH_HEIGHT;
+      chunk->startZ = (i / PIPELINE_BENCH_HEIGHT) % PIPELINE_BENCH_WIDTH;
+      chunk->loaded = true;
+      insertChunk(chunk);
+   }
+   return chunks;
+}
+
+// Hashes every cube and vertex and then unloads the chunks.
+static U64 unloadBenchChunks(Chunk *chunks) {
+   U64 hash = 14695981039346656037ULL;
+   for (S32 i = 0; i < PIPELINE_BENCH_CHUNKS; ++i) {
+      Chunk *chunk = &chunks[i];
+      for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+         for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+            for (S32 y = 0; y < CHUNK_HEIGHT; ++y) {
+               U16 cube = packCube(getCubeAt(chunk, x, y, z));
+               hash = hashBytes(hash, &cube, sizeof(cube));
+            }
+         }
+      }
+
+      RenderChunk *renderChunk = &chunk->renderChunk;
+      hash = hashBytes(hash, renderChunk->vertexData, renderChunk->vertexCount * sizeof(GPUVertex));
+      freeRenderChunkGeometry(renderChunk);
+   }
+
+   for (S32 i = 0; i < PIPELINE_BENCH_CHUNKS; ++i) {
+      removeChunk(&chunks[i]);
+      freeChunkSection(&chunks[i].section);
+   }
+   free(chunks);
+   return hash;
+}
+
+/// The window of chunks the walk ends up in, and how many chunk steps it
+/// takes to get there.
+#define PIPELINE_WALK_WIDTH 4
+#define PIPELINE_WALK_CHUNKS (PIPELINE_WALK_WIDTH * PIPELINE_WALK_WIDTH * PIPELINE_BENCH_HEIGHT)
+#define PIPELINE_WALK_STEPS 6
+
+/// Where the walk starts. With 16 cube chunks it ends with chunk 63, 4, -14
+/// on the trailing x border, where a cave reaches the surface next to a
+/// drop in the terrain. Treating the unloaded side as solid carves it
+/// differently.
+#define PIPELINE_WALK_START_X 60
+#define PIPELINE_WALK_START_Z -18
+
+// Chunks of the window at originX, originZ are stored x, z, y. Chunks of
+// the old window that are still inside are kept, the rest are unloaded and
+// the new ones are generated.
+static void movePipelineWalkWindow(Chunk **window, S32 originX, S32 originZ) {
+   Chunk *kept[PIPELINE_WALK_CHUNKS] = { NULL };
+   for (S32 i = 0; i < PIPELINE_WALK_CHUNKS; ++i) {
+      Chunk *chunk = window[i];
+      if (chunk == NULL)
+         continue;
+      S32 x = chunk->startX - originX;
+      S32 z = chunk->startZ - originZ;
+      if (x >= 0 && x < PIPELINE_WALK_WIDTH && z >= 0 && z < PIPELINE_WALK_WIDTH) {
+         kept[(x * PIPELINE_WALK_WIDTH + z) * PIPELINE_BENCH_HEIGHT + chunk->startY] = chunk;
+      } else {
+         removeChunk(chunk);
+         freeCaveDensity(chunk);
+         freeChunkSection(&chunk->section);
+         free(chunk);
+      }
+   }
+
+   Chunk *batch[PIPELINE_WALK_CHUNKS];
+   S32 batchCount = 0;
+   for (S32 i = 0; i < PIPELINE_WALK_CHUNKS; ++i) {
+      window[i] = kept[i];
+      if (window[i] != NULL)
+         continue;
+      Chunk *chunk = (Chunk*)calloc(1, sizeof(Chunk));
+      chunk->startX = originX + i / (PIPELINE_WALK_WIDTH * PIPELINE_BENCH_HEIGHT);
+      chunk->startY = i % PIPELINE_BENCH_HEIGHT;
+      chunk->startZ = originZ + (i / PIPELINE_BENCH_HEIGHT) % PIPELINE_WALK_WIDTH;
+      chunk->loaded = true;
+      insertChunk(chunk);
+      window[i] = chunk;
+      batch[batchCount++] = chunk;
+   }
+   runChunkPipeline(batch, batchCount);
+}
+
+// Hashes every cube of the window and then unloads it.
+static U64 unloadPipelineWalkWindow(Chunk **window) {
+   U64 hash = 14695981039346656037ULL;
+   for (S32 i = 0; i < PIPELINE_WALK_CHUNKS; ++i) {
+      Chunk *chunk = window[i];
+      for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+         for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+            for (S32 y = 0; y < CHUNK_HEIGHT; ++y) {
+               U16 cube = packCube(getCubeAt(chunk, x, y, z));
+               hash = hashBytes(hash, &cube, sizeof(cube));
+            }
+         }
+      }
+      removeChunk(chunk);
+      freeCaveDensity(chunk);
+      freeChunkSection(&chunk->section);
+      free(chunk);
+      window[i] = NULL;
+   }
+   return hash;
+}
+
+// Counts the columns along the border of the window whose surface is at a
+// different height from the column just outside, where what is past the
+// border matters to cave smoothing.
+static S32 countPipelineWalkEdgeSteps(S32 originX, S32 originZ) {
+   S32 minX = originX * CHUNK_WIDTH;
+   S32 minZ = originZ * CHUNK_WIDTH;
+   S32 maxX = minX + PIPELINE_WALK_WIDTH * CHUNK_WIDTH - 1;
+   S32 maxZ = minZ + PIPELINE_WALK_WIDTH * CHUNK_WIDTH - 1;
+   S32 steps = 0;
+   for (S32 i = 0; i < PIPELINE_WALK_WIDTH * CHUNK_WIDTH; ++i) {
+      steps += getTerrainHeight(minX, minZ + i) != getTerrainHeight(minX - 1, minZ + i);
+      steps += getTerrainHeight(maxX, minZ + i) != getTerrainHeight(maxX + 1, minZ + i);
+      steps += getTerrainHeight(minX + i, minZ) != getTerrainHeight(minX + i, minZ - 1);
+      steps += getTerrainHeight(minX + i, maxZ) != getTerrainHeight(minX + i, maxZ + 1);
+   }
+   return steps;
+}
+
+// Walks a window of chunks a chunk at a time, x and z in turn, and checks
+// that it ends up with the same cubes as loading the last window at once.
+// Chunks along the trailing borders were generated with their neighbours
+// loaded, the fresh ones without.
+static void runPipelineWalkBenchmark(const char *suite) {
+   Chunk *window[PIPELINE_WALK_CHUNKS] = { NULL };
+   S32 originX = PIPELINE_WALK_START_X;
+   S32 originZ = PIPELINE_WALK_START_Z;
+
+   initChunkPipeline(-1);
+   setChunkPipelineTarget(ChunkStatus_Decorated);
+
+   F64 start = benchWallTime();
+   movePipelineWalkWindow(window, originX, originZ);
+   for (S32 step = 0; step < PIPELINE_WALK_STEPS; ++step) {
+      if (step % 2 == 0)
+         ++originX;
+      else
+         ++originZ;
+      movePipelineWalkWindow(window, originX, originZ);
+   }
+   F64 time = benchWallTime() - start;
+   benchReport(suite, "walk (per step)", time, (F64)(PIPELINE_WALK_STEPS + 1));
+   U64 walkedHash = unloadPipelineWalkWindow(window);
+
+   movePipelineWalkWindow(window, originX, originZ);
+   U64 freshHash = unloadPipelineWalkWindow(window);
+
+   setChunkPipelineTarget(ChunkStatus_Meshed);
+   freeChunkPipeline();
+
+   printf("%-10s walked window: %d border columns step, %s a fresh load\n", suite, countPipelineWalkEdgeSteps(originX, originZ),
+      walkedHash == freshHash ? "identical to" : "MISMATCH with");
+}
+
+void runPipelineBenchmarks() {
+   const char *suite = "pipeline";
+
+   initWorldGen((U64)0xDEADBEEF);
+   initChunkSectionPools();
+   initMeshScratch();
+   initHashMap(&gChunkMap, PIPELINE_BENCH_CHUNKS);
+   initHashMap(&gChunkColumnMap, PIPELINE_BENCH_WIDTH * PIPELINE_BENCH_WIDTH);
+
+   // One pass after another, the way the world used to be generated.
+   Chunk *chunks = loadBenchChunks();
+   F64 start = benchWallTime();
+   for (S32 i = 0; i < PIPELINE_BENCH_CHUNKS; ++i)
+      generateWorld(&chunks[i]);
+   for (S32 i = 0; i < PIPELINE_BENCH_CHUNKS; ++i)
+      generateCaves(&chunks[i]);
+   for (S32 i = 0; i < PIPELINE_BENCH_CHUNKS; ++i)
+      generateStructures(&chunks[i]);
+   for (S32 i = 0; i < PIPELINE_BENCH_CHUNKS; ++i)
+      generateGeometry(&chunks[i]);
+   F64 serialTime = benchWallTime() - start;
+   benchReport(suite, "serial (per chunk)", serialTime, (F64)PIPELINE_BENCH_CHUNKS);
+   U64 serialHash = unloadBenchChunks(chunks);
+
+   Chunk *batch[PIPELINE_BENCH_CHUNKS];
+   S32 processorCount = getProcessorCount();
+   for (S32 threads = 1; ; threads *= 2) {
+      if (threads > processorCount)
+         threads = processorCount;
+
+      initChunkPipeline(threads - 1);
+      chunks = loadBenchChunks();
+      for (S32 i = 0; i < PIPELINE_BENCH_CHUNKS; ++i)
+         batch[i] = &chunks[i];
+
+      start = benchWallTime();
+      runChunkPipeline(batch, PIPELINE_BENCH_CHUNKS);
+      F64 time = benchWallTime() - start;
+      freeChunkPipeline();
+
+      char name[32];
+      snprintf(name, sizeof(name), "%d threads (per chunk)", threads);
+      benchReport(suite, name, time, (F64)PIPELINE_BENCH_CHUNKS);
+      U64 hash = unloadBenchChunks(chunks);
+      printf("%-10s %d threads: %.2fx serial, %s\n", suite, threads, serialTime / time, hash == serialHash ? "identical" : "MISMATCH");
+
+      if (threads == processorCount)
+         break;
+   }
+
+   runPipelineWalkBenchmark(suite);
+
+   freeHashMap(&gChunkMap);
+   freeHashMap(&gChunkColumnMap);
+   freeChunkSectionPools();
+   freeMeshScratch();
+   freeWorldGen();
+}
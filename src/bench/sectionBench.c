@@ -0,0 +1,185 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include "bench/bench.h"
+#include "game/chunkSection.h"
+
+// Compares the palette compressed sections against the old layout of one
+// full Cube per position in a chunk column.
+
+#define SECTION_BENCH_CHUNKS 64
+#define SECTION_BENCH_RANDOM_OPS (1 << 22)
+#define SECTION_BENCH_STREAM_COLUMNS 1024
+
+// Each benchmark column is a 256 tall stack of sections.
+#define SECTION_BENCH_COLUMN_HEIGHT 256
+#define SECTION_BENCH_COLUMN_SECTIONS (SECTION_BENCH_COLUMN_HEIGHT / CHUNK_HEIGHT)
+#define SECTION_BENCH_COLUMN_SIZE (CHUNK_WIDTH * CHUNK_WIDTH * SECTION_BENCH_COLUMN_HEIGHT)
+
+static inline S32 getFlatIndex(S32 x, S32 y, S32 z) {
+   return x * (SECTION_BENCH_COLUMN_HEIGHT) * (CHUNK_WIDTH) + z * (SECTION_BENCH_COLUMN_HEIGHT) + y;
+}
+
+// Rough terrain profile: bedrock, dirt up to a wavy surface, grass and then air.
+static Material getBenchMaterial(S32 x, S32 y, S32 z) {
+   S32 height = 64 + ((x * 7 + z * 3) % 9);
+   if (y < 4)
+      return Material_Bedrock;
+   if (y < height)
+      return Material_Dirt;
+   if (y == height)
+      return Material_Grass;
+   return Material_Air;
+}
+
+static inline U32 nextRandom(U32 *state) {
+   *state = *state * 1664525U + 1013904223U;
+   return *state >> 8;
+}
+
+static volatile U32 gSink;
+
+static void benchFlat() {
+   Cube **chunks = (Cube**)calloc(SECTION_BENCH_CHUNKS, sizeof(Cube*));
+   F64 start = benchTime();
+   for (S32 c = 0; c < SECTION_BENCH_CHUNKS; ++c) {
+      chunks[c] = (Cube*)calloc(SECTION_BENCH_COLUMN_SIZE, sizeof(Cube));
+      for (S32 x = 0; x < CHUNK_WIDTH; ++x)
+         for (S32 z = 0; z < CHUNK_WIDTH; ++z)
+            for (S32 y = 0; y < SECTION_BENCH_COLUMN_HEIGHT; ++y)
+               chunks[c][getFlatIndex(x, y, z)].material = getBenchMaterial(x, y, z);
+   }
+   benchReport("flat", "sequential write", benchTime() - start, (F64)SECTION_BENCH_CHUNKS * SECTION_BENCH_COLUMN_SIZE);
+
+   U32 sum = 0;
+   start = benchTime();
+   for (S32 c = 0; c < SECTION_BENCH_CHUNKS; ++c)
+      for (S32 x = 0; x < CHUNK_WIDTH; ++x)
+         for (S32 z = 0; z < CHUNK_WIDTH; ++z)
+            for (S32 y = 0; y < SECTION_BENCH_COLUMN_HEIGHT; ++y)
+               sum += chunks[c][getFlatIndex(x, y, z)].material;
+   benchReport("flat", "sequential read", benchTime() - start, (F64)SECTION_BENCH_CHUNKS * SECTION_BENCH_COLUMN_SIZE);
+
+   U32 seed = 1;
+   start = benchTime();
+   for (S32 i = 0; i < SECTION_BENCH_RANDOM_OPS; ++i) {
+      U32 r = nextRandom(&seed);
+      sum += chunks[r % SECTION_BENCH_CHUNKS][getFlatIndex((r >> 6) % CHUNK_WIDTH, (r >> 10) & 255, (r >> 18) % CHUNK_WIDTH)].material;
+   }
+   benchReport("flat", "random read", benchTime() - start, (F64)SECTION_BENCH_RANDOM_OPS);
+
+   start = benchTime();
+   for (S32 i = 0; i < SECTION_BENCH_RANDOM_OPS; ++i) {
+      U32 r = nextRandom(&seed);
+      chunks[r % SECTION_BENCH_CHUNKS][getFlatIndex((r >> 6) % CHUNK_WIDTH, (r >> 10) & 255, (r >> 18) % CHUNK_WIDTH)].material = Material_Leaves;
+   }
+   benchReport("flat", "random write", benchTime() - start, (F64)SECTION_BENCH_RANDOM_OPS);
+
+   printf("flat       memory: %lu KB\n", (unsigned long)(SECTION_BENCH_CHUNKS * SECTION_BENCH_COLUMN_SIZE * sizeof(Cube) / 1024));
+
+   for (S32 c = 0; c < SECTION_BENCH_CHUNKS; ++c)
+      free(chunks[c]);
+   free(chunks);
+   gSink = sum;
+}
+
+static void benchSections() {
+   initChunkSectionPools();
+   ChunkSection *sections = (ChunkSection*)calloc(SECTION_BENCH_CHUNKS * SECTION_BENCH_COLUMN_SECTIONS, sizeof(ChunkSection));
+   F64 start = benchTime();
+   for (S32 c = 0; c < SECTION_BENCH_CHUNKS; ++c) {
+      ChunkSection *column = &sections[c * SECTION_BENCH_COLUMN_SECTIONS];
+      for (S32 i = 0; i < SECTION_BENCH_COLUMN_SECTIONS; ++i)
+         initChunkSection(&column[i], createCube(Material_Air));
+      for (S32 x = 0; x < CHUNK_WIDTH; ++x)
+         for (S32 z = 0; z < CHUNK_WIDTH; ++z)
+            for (S32 y = 0; y < SECTION_BENCH_COLUMN_HEIGHT; ++y)
+               setSectionCube(&column[y / CHUNK_HEIGHT], x, y % CHUNK_HEIGHT, z, createCube(getBenchMaterial(x, y, z)));
+   }
+   benchReport("section", "sequential write", benchTime() - start, (F64)SECTION_BENCH_CHUNKS * SECTION_BENCH_COLUMN_SIZE);
+
+   WordSize memory = 0;
+   for (S32 i = 0; i < SECTION_BENCH_CHUNKS * SECTION_BENCH_COLUMN_SECTIONS; ++i)
+      memory += getChunkSectionMemoryUsage(&sections[i]);
+   printf("section    memory: %lu KB\n", (unsigned long)(memory / 1024));
+
+   U32 sum = 0;
+   start = benchTime();
+   for (S32 c = 0; c < SECTION_BENCH_CHUNKS; ++c) {
+      ChunkSection *column = &sections[c * SECTION_BENCH_COLUMN_SECTIONS];
+      for (S32 x = 0; x < CHUNK_WIDTH; ++x)
+         for (S32 z = 0; z < CHUNK_WIDTH; ++z)
+            for (S32 y = 0; y < SECTION_BENCH_COLUMN_HEIGHT; ++y)
+               sum += getSectionCube(&column[y / CHUNK_HEIGHT], x, y % CHUNK_HEIGHT, z).material;
+   }
+   benchReport("section", "sequential read", benchTime() - start, (F64)SECTION_BENCH_CHUNKS * SECTION_BENCH_COLUMN_SIZE);
+
+   U32 seed = 1;
+   start = benchTime();
+   for (S32 i = 0; i < SECTION_BENCH_RANDOM_OPS; ++i) {
+      U32 r = nextRandom(&seed);
+      S32 y = (r >> 10) & 255;
+      ChunkSection *section = &sections[(r % SECTION_BENCH_CHUNKS) * SECTION_BENCH_COLUMN_SECTIONS + y / CHUNK_HEIGHT];
+      sum += getSectionCube(section, (r >> 6) % CHUNK_WIDTH, y % CHUNK_HEIGHT, (r >> 18) % CHUNK_WIDTH).material;
+   }
+   benchReport("section", "random read", benchTime() - start, (F64)SECTION_BENCH_RANDOM_OPS);
+
+   start = benchTime();
+   for (S32 i = 0; i < SECTION_BENCH_RANDOM_OPS; ++i) {
+      U32 r = nextRandom(&seed);
+      S32 y = (r >> 10) & 255;
+      ChunkSection *section = &sections[(r % SECTION_BENCH_CHUNKS) * SECTION_BENCH_COLUMN_SECTIONS + y / CHUNK_HEIGHT];
+      setSectionCube(section, (r >> 6) % CHUNK_WIDTH, y % CHUNK_HEIGHT, (r >> 18) % CHUNK_WIDTH, createCube(Material_Leaves));
+   }
+   benchReport("section", "random write", benchTime() - start, (F64)SECTION_BENCH_RANDOM_OPS);
+
+   // Streaming: unload and regenerate chunk columns over and over like the
+   // chunk window does. Once warmed up every allocation should come out of
+   // a pool's free list and the peak shouldn't move.
+   PoolStats before;
+   getChunkSectionPoolStats(&before);
+   start = benchTime();
+   for (S32 i = 0; i < SECTION_BENCH_STREAM_COLUMNS; ++i) {
+      ChunkSection *column = &sections[(i % SECTION_BENCH_CHUNKS) * SECTION_BENCH_COLUMN_SECTIONS];
+      for (S32 j = 0; j < SECTION_BENCH_COLUMN_SECTIONS; ++j) {
+         freeChunkSection(&column[j]);
+         initChunkSection(&column[j], createCube(Material_Air));
+      }
+      for (S32 x = 0; x < CHUNK_WIDTH; ++x)
+         for (S32 z = 0; z < CHUNK_WIDTH; ++z)
+            for (S32 y = 0; y < SECTION_BENCH_COLUMN_HEIGHT; ++y)
+               setSectionCube(&column[y / CHUNK_HEIGHT], x, y % CHUNK_HEIGHT, z, createCube(getBenchMaterial(x + i, y, z)));
+   }
+   benchReport("section", "stream column", benchTime() - start, (F64)SECTION_BENCH_STREAM_COLUMNS);
+
+   PoolStats after;
+   getChunkSectionPoolStats(&after);
+   printf("section    pools: %u live, peak %u -> %u, %.1f%% reused while streaming\n", after.liveCount, before.highWaterMark, after.highWaterMark,
+      (F64)(after.reuseCount - before.reuseCount) * 100.0 / (F64)(after.allocCount - before.allocCount));
+
+   for (S32 i = 0; i < SECTION_BENCH_CHUNKS * SECTION_BENCH_COLUMN_SECTIONS; ++i)
+      freeChunkSection(&sections[i]);
+
+   free(sections);
+   freeChunkSectionPools();
+   gSink = sum;
+}
+
+void runSectionBenchmarks() {
+   benchFlat();
+   benchSections();
+}
@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "bench/bench.h"
+#include "game/worldGen.h"
+
+// Compares the terrain height noise against running the whole smoothing
+// filter for every column. They have to agree on every column.
+
+#define TERRAIN_BENCH_WIDTH 256
+
+static volatile S32 gSink;
+
+void runTerrainBenchmarks() {
+   const char *suite = "terrain";
+   const F64 columns = (F64)(TERRAIN_BENCH_WIDTH * TERRAIN_BENCH_WIDTH);
+
+   initWorldGen((U64)0xDEADBEEF);
+
+   // Start off at a negative position so that rounding towards zero gets
+   // covered as well.
+   S32 sum = 0;
+   F64 start = benchTime();
+   for (S32 x = -TERRAIN_BENCH_WIDTH / 2; x < TERRAIN_BENCH_WIDTH / 2; ++x) {
+      for (S32 z = -TERRAIN_BENCH_WIDTH / 2; z < TERRAIN_BENCH_WIDTH / 2; ++z)
+         sum += getTerrainHeightReference(x, z);
+   }
+   benchReport(suite, "full filter (per column)", benchTime() - start, columns);
+
+   start = benchTime();
+   for (S32 x = -TERRAIN_BENCH_WIDTH / 2; x < TERRAIN_BENCH_WIDTH / 2; ++x) {
+      for (S32 z = -TERRAIN_BENCH_WIDTH / 2; z < TERRAIN_BENCH_WIDTH / 2; ++z)
+         sum += getTerrainHeight(x, z);
+   }
+   benchReport(suite, "height (per column)", benchTime() - start, columns);
+
+   S32 mismatches = 0;
+   for (S32 x = -TERRAIN_BENCH_WIDTH / 2; x < TERRAIN_BENCH_WIDTH / 2; ++x) {
+      for (S32 z = -TERRAIN_BENCH_WIDTH / 2; z < TERRAIN_BENCH_WIDTH / 2; ++z) {
+         if (getTerrainHeight(x, z) != getTerrainHeightReference(x, z))
+            mismatches++;
+      }
+   }
+   printf("%-10s %d columns, %d mismatches\n", suite, TERRAIN_BENCH_WIDTH * TERRAIN_BENCH_WIDTH, mismatches);
+
+   freeWorldGen();
+   gSink = sum;
+}
@@ -0,0 +1,50 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include "game/blockCursor.h"
+
+void initBlockCursor(BlockCursor *cursor, S32 x, S32 y, S32 z) {
+   cursor->chunkX = getChunkCoordinate(x, CHUNK_WIDTH);
+   cursor->chunkY = getChunkCoordinate(y, CHUNK_HEIGHT);
+   cursor->chunkZ = getChunkCoordinate(z, CHUNK_WIDTH);
+   cursor->x = x - (cursor->chunkX * CHUNK_WIDTH);
+   cursor->y = y - (cursor->chunkY * CHUNK_HEIGHT);
+   cursor->z = z - (cursor->chunkZ * CHUNK_WIDTH);
+   cursor->chunk = getChunkAt(cursor->chunkX, cursor->chunkY, cursor->chunkZ);
+}
+
+void moveBlockCursor(BlockCursor *cursor, S32 x, S32 y, S32 z) {
+   S32 dx = x - getBlockCursorWorldX(cursor);
+   S32 dy = y - getBlockCursorWorldY(cursor);
+   S32 dz = z - getBlockCursorWorldZ(cursor);
+   if (dx < -1 || dx > 1 || dy < -1 || dy > 1 || dz < -1 || dz > 1) {
+      initBlockCursor(cursor, x, y, z);
+      return;
+   }
+
+   if (dx == 1)
+      stepXPos(cursor);
+   else if (dx == -1)
+      stepXNeg(cursor);
+   if (dy == 1)
+      stepYPos(cursor);
+   else if (dy == -1)
+      stepYNeg(cursor);
+   if (dz == 1)
+      stepZPos(cursor);
+   else if (dz == -1)
+      stepZNeg(cursor);
+}
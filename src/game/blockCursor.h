@@ -0,0 +1,158 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _GAME_BLOCKCURSOR_H_
+#define _GAME_BLOCKCURSOR_H_
+
+#include "game/chunk.h"
+
+/// A position in the world that remembers which chunk it is in.
+///
+/// Looking a cube up by world position costs a few signed divides and a
+/// chunk map lookup. A cursor does that once and then moves one cube at a
+/// time, only changing chunk when it steps over a border, and then through
+/// the chunk's neighbour links rather than the chunk map.
+///
+/// A cursor can be in a chunk that isn't loaded (chunk is NULL). Such
+/// positions read as solid, like isTransparentAtWorldSpacePosition.
+typedef struct BlockCursor {
+   Chunk *chunk; /// The chunk the cursor is in, NULL if it isn't loaded.
+   S32 chunkX;   /// Chunk coordinates of the chunk the cursor is in.
+   S32 chunkY;
+   S32 chunkZ;
+   S32 x;        /// Local x position [0, CHUNK_WIDTH).
+   S32 y;        /// Local y position [0, CHUNK_HEIGHT).
+   S32 z;        /// Local z position [0, CHUNK_WIDTH).
+} BlockCursor;
+
+/// Places a cursor at a world position.
+void initBlockCursor(BlockCursor *cursor, S32 x, S32 y, S32 z);
+
+/// Places a cursor at a local position within a loaded chunk. No lookups.
+static inline void initBlockCursorInChunk(BlockCursor *cursor, Chunk *chunk, S32 x, S32 y, S32 z) {
+   cursor->chunk = chunk;
+   cursor->chunkX = chunk->startX;
+   cursor->chunkY = chunk->startY;
+   cursor->chunkZ = chunk->startZ;
+   cursor->x = x;
+   cursor->y = y;
+   cursor->z = z;
+}
+
+/// Moves a cursor to a world position. Moves of a single cube along each
+/// axis go through the neighbour links, anything further starts over.
+void moveBlockCursor(BlockCursor *cursor, S32 x, S32 y, S32 z);
+
+// Re-resolves the chunk after crossing a border. Neighbour links are used
+// when we came from a loaded chunk.
+static inline void setBlockCursorChunk(BlockCursor *cursor, ChunkNeighbour direction) {
+   if (cursor->chunk != NULL)
+      cursor->chunk = cursor->chunk->neighbours[direction];
+   else
+      cursor->chunk = getChunkAt(cursor->chunkX, cursor->chunkY, cursor->chunkZ);
+}
+
+static inline void stepXPos(BlockCursor *cursor) {
+   if (++cursor->x == CHUNK_WIDTH) {
+      cursor->x = 0;
+      cursor->chunkX++;
+      setBlockCursorChunk(cursor, ChunkNeighbour_PositiveX);
+   }
+}
+
+static inline void stepXNeg(BlockCursor *cursor) {
+   if (--cursor->x < 0) {
+      cursor->x = CHUNK_WIDTH - 1;
+      cursor->chunkX--;
+      setBlockCursorChunk(cursor, ChunkNeighbour_NegativeX);
+   }
+}
+
+static inline void stepYPos(BlockCursor *cursor) {
+   if (++cursor->y == CHUNK_HEIGHT) {
+      cursor->y = 0;
+      cursor->chunkY++;
+      setBlockCursorChunk(cursor, ChunkNeighbour_PositiveY);
+   }
+}
+
+static inline void stepYNeg(BlockCursor *cursor) {
+   if (--cursor->y < 0) {
+      cursor->y = CHUNK_HEIGHT - 1;
+      cursor->chunkY--;
+      setBlockCursorChunk(cursor, ChunkNeighbour_NegativeY);
+   }
+}
+
+static inline void stepZPos(BlockCursor *cursor) {
+   if (++cursor->z == CHUNK_WIDTH) {
+      cursor->z = 0;
+      cursor->chunkZ++;
+      setBlockCursorChunk(cursor, ChunkNeighbour_PositiveZ);
+   }
+}
+
+static inline void stepZNeg(BlockCursor *cursor) {
+   if (--cursor->z < 0) {
+      cursor->z = CHUNK_WIDTH - 1;
+      cursor->chunkZ--;
+      setBlockCursorChunk(cursor, ChunkNeighbour_NegativeZ);
+   }
+}
+
+static inline S32 getBlockCursorWorldX(const BlockCursor *cursor) {
+   return cursor->chunkX * CHUNK_WIDTH + cursor->x;
+}
+
+static inline S32 getBlockCursorWorldY(const BlockCursor *cursor) {
+   return cursor->chunkY * CHUNK_HEIGHT + cursor->y;
+}
+
+static inline S32 getBlockCursorWorldZ(const BlockCursor *cursor) {
+   return cursor->chunkZ * CHUNK_WIDTH + cursor->z;
+}
+
+/// Reads the cube under the cursor.
+/// @param cube Output for the cube.
+/// @return false if the cursor isn't in a loaded chunk.
+static inline bool getBlockCursorCube(const BlockCursor *cursor, Cube *cube) {
+   if (cursor->chunk == NULL)
+      return false;
+   *cube = getCubeAt(cursor->chunk, cursor->x, cursor->y, cursor->z);
+   return true;
+}
+
+/// Cubes outside of the loaded world are treated as solid.
+static inline bool isBlockCursorTransparent(const BlockCursor *cursor) {
+   if (cursor->chunk == NULL)
+      return false;
+   return isTransparent(cursor->chunk, cursor->x, cursor->y, cursor->z);
+}
+
+/// @return The section the cursor is in, or NULL if it isn't loaded.
+static inline ChunkSection* getBlockCursorSection(const BlockCursor *cursor) {
+   if (cursor->chunk == NULL)
+      return NULL;
+   return &cursor->chunk->section;
+}
+
+/// Writes the cube under the cursor. The cursor must be in a loaded chunk.
+static inline void setBlockCursorCube(const BlockCursor *cursor, Material material) {
+   assert(cursor->chunk != NULL);
+   setCubeAt(cursor->chunk, cursor->x, cursor->y, cursor->z, material);
+}
+
+#endif
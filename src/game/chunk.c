@@ -0,0 +1,99 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include "game/chunk.h"
+
+HashMap gChunkMap;
+HashMap gChunkColumnMap;
+
+Chunk* getChunkAt(S32 x, S32 y, S32 z) {
+   return (Chunk*)hashMapGet(&gChunkMap, getChunkKey(x, y, z));
+}
+
+// Chunk offsets of each ChunkNeighbour.
+static const S32 gChunkNeighbourOffsets[ChunkNeighbour_Count][3] = {
+   { -1, 0, 0 },
+   { 1, 0, 0 },
+   { 0, -1, 0 },
+   { 0, 1, 0 },
+   { 0, 0, -1 },
+   { 0, 0, 1 }
+};
+
+static ChunkColumn* acquireChunkColumn(S32 x, S32 z) {
+   U64 key = getChunkColumnKey(x, z);
+   ChunkColumn *column = (ChunkColumn*)hashMapGet(&gChunkColumnMap, key);
+   if (column == NULL) {
+      column = (ChunkColumn*)calloc(1, sizeof(ChunkColumn));
+      column->x = x;
+      column->z = z;
+      hashMapInsert(&gChunkColumnMap, key, column);
+   }
+   column->chunkCount++;
+   return column;
+}
+
+static void releaseChunkColumn(ChunkColumn *column) {
+   assert(column->chunkCount > 0);
+   if (--column->chunkCount == 0) {
+      hashMapRemove(&gChunkColumnMap, getChunkColumnKey(column->x, column->z));
+      free(column);
+   }
+}
+
+void insertChunk(Chunk *chunk) {
+   hashMapInsert(&gChunkMap, getChunkKey(chunk->startX, chunk->startY, chunk->startZ), chunk);
+   chunk->column = acquireChunkColumn(chunk->startX, chunk->startZ);
+
+   for (S32 i = 0; i < ChunkNeighbour_Count; ++i) {
+      const S32 *offset = gChunkNeighbourOffsets[i];
+      Chunk *neighbour = getChunkAt(chunk->startX + offset[0], chunk->startY + offset[1], chunk->startZ + offset[2]);
+      chunk->neighbours[i] = neighbour;
+      if (neighbour != NULL)
+         neighbour->neighbours[getOppositeChunkNeighbour((ChunkNeighbour)i)] = chunk;
+   }
+}
+
+void removeChunk(Chunk *chunk) {
+   hashMapRemove(&gChunkMap, getChunkKey(chunk->startX, chunk->startY, chunk->startZ));
+   releaseChunkColumn(chunk->column);
+   chunk->column = NULL;
+
+   for (S32 i = 0; i < ChunkNeighbour_Count; ++i) {
+      if (chunk->neighbours[i] != NULL)
+         chunk->neighbours[i]->neighbours[getOppositeChunkNeighbour((ChunkNeighbour)i)] = NULL;
+      chunk->neighbours[i] = NULL;
+   }
+}
+
+void initChunkCubes(Chunk *chunk, Material fill) {
+   initChunkSection(&chunk->section, createCube(fill));
+   S8 height = fill == Material_Air ? -1 : CHUNK_HEIGHT - 1;
+   for (S32 i = 0; i < CHUNK_WIDTH * CHUNK_WIDTH; ++i)
+      chunk->heightmap[i] = height;
+}
+
+S32 scanColumnHeight(Chunk *chunk, S32 x, S32 fromY, S32 z) {
+   if (isSectionEmpty(&chunk->section))
+      return -1;
+
+   for (S32 y = fromY; y >= 0; --y) {
+      if (getSectionCube(&chunk->section, x, y, z).material != Material_Air)
+         return y;
+   }
+   return -1;
+}
@@ -0,0 +1,263 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _GAME_CHUNK_H_
+#define _GAME_CHUNK_H_
+
+#include <assert.h>
+#include "base/hashMap.h"
+#include "game/chunkSection.h"
+#include "math/math.h"
+
+#if CHUNK_WIDTH > 255 || CHUNK_HEIGHT > 255
+#error GPUVertex packs the position of a vertex within its chunk into a byte per axis.
+#endif
+
+/// A corner of a face of a chunk's mesh. The position is local to the chunk,
+/// which is moved into place by its model matrix.
+typedef struct GPUVertex {
+   U8 x;     /// Local position, 0 to CHUNK_WIDTH or CHUNK_HEIGHT inclusive.
+   U8 y;
+   U8 z;
+   U8 side;  /// The CubeSides the face points to.
+   U8 u;     /// Texture coordinates in cubes. The material's tile of the atlas repeats every cube.
+   U8 v;
+   U8 tileX; /// Column and row of the face material's tile in the texture atlas.
+   U8 tileY;
+} GPUVertex;
+
+/// Every face is a quad of 4 vertices drawn as 2 triangles. The indices are
+/// the same for every chunk, so one index buffer is shared by all of them,
+/// see fillQuadIndices.
+#define QUAD_VERTEX_COUNT 4
+#define QUAD_INDEX_COUNT 6
+
+typedef U16 GPUIndex;
+
+/// The most quads one draw call can index into with a GPUIndex. Meshes with
+/// more quads than this are drawn in several calls.
+#define QUAD_INDEX_MAX_QUADS (65536 / QUAD_VERTEX_COUNT)
+
+typedef struct RenderChunk {
+   GPUVertex *vertexData; /// Mesh scratch buffer, see acquireMeshScratch in mesher.c.
+   S32 vertexCount;       /// VertexData Count, QUAD_VERTEX_COUNT per face.
+   S32 vertexCapacity;    /// Number of vertices vertexData has room for.
+} RenderChunk;
+
+/// The uploaded mesh of a chunk. Only touched on the main thread, so the
+/// old mesh keeps drawing while the chunk is remeshed in the background.
+typedef struct ChunkGL {
+   U32 vbo;               /// OpenGL Vertex Buffer Object
+   S32 quadCount;         /// Number of quads in vbo, 0 if nothing is uploaded.
+   U32 vboSize;           /// Bytes allocated for vbo. A new mesh that fits is written into it.
+} ChunkGL;
+
+/// Neighbours of a chunk. Opposite directions differ only in the lowest bit.
+typedef enum ChunkNeighbour {
+   ChunkNeighbour_NegativeX,
+   ChunkNeighbour_PositiveX,
+   ChunkNeighbour_NegativeY,
+   ChunkNeighbour_PositiveY,
+   ChunkNeighbour_NegativeZ,
+   ChunkNeighbour_PositiveZ,
+   ChunkNeighbour_Count
+} ChunkNeighbour;
+
+static inline ChunkNeighbour getOppositeChunkNeighbour(ChunkNeighbour direction) {
+   return (ChunkNeighbour)(direction ^ 1);
+}
+
+/// How far along a chunk is in the generation pipeline. Each status is
+/// reached in order. See chunkPipeline.h for what each step depends on.
+typedef enum ChunkStatus {
+   ChunkStatus_Empty,     /// Just loaded, nothing generated yet.
+   ChunkStatus_Terrain,   /// Base terrain is generated.
+   ChunkStatus_Carved,    /// Caves are carved out.
+   ChunkStatus_Decorated, /// Trees are planted. Needs to be meshed.
+   ChunkStatus_Meshed     /// Geometry is up to date.
+} ChunkStatus;
+
+/// Trees can grow into a column from roots this many cubes before its first
+/// x, z and after its last, as their leaves are wider than the trunk.
+#define TREE_ROOT_APRON_BEFORE 2
+#define TREE_ROOT_APRON_AFTER 3
+#define TREE_ROOT_AREA_WIDTH (TREE_ROOT_APRON_BEFORE + CHUNK_WIDTH + TREE_ROOT_APRON_AFTER)
+
+/// Where a tree grows. x and z are local to the column that lists it and
+/// can be outside of it.
+typedef struct TreeRoot {
+   S16 x;
+   S16 y; /// World y of the grass the tree grows on.
+   S16 z;
+} TreeRoot;
+
+/// Data shared by every chunk stacked on top of each other at the same x, z.
+/// A column exists as long as at least one of its chunks is loaded.
+typedef struct ChunkColumn {
+   S32 x;
+   S32 z;
+   U32 chunkCount;  /// Number of loaded chunks in this column.
+   bool hasTerrain; /// Has terrainHeight been generated yet?
+   bool busy;       /// A pipeline job is generating terrainHeight.
+   S16 terrainHeight[CHUNK_WIDTH * CHUNK_WIDTH]; /// World y of the generated surface. See getColumnIndex.
+   U32 treeRootCount;
+   TreeRoot treeRoots[TREE_ROOT_AREA_WIDTH * TREE_ROOT_AREA_WIDTH]; /// Every tree that grows into the column, generated with terrainHeight.
+} ChunkColumn;
+
+/// A CHUNK_WIDTH x CHUNK_HEIGHT x CHUNK_WIDTH cube of the world. Chunks are
+/// loaded and unloaded independently in all three axes, so the world has no
+/// height limit.
+typedef struct Chunk {
+   S32 startX;                   /// Chunk coordinates.
+   S32 startY;
+   S32 startZ;
+   bool loaded;                  /// Is this window slot in use?
+   bool busy;                    /// A pipeline job is running on this chunk.
+   ChunkStatus status;           /// How far along generation is.
+   ChunkSection section;         /// Palette compressed cube data.
+   RenderChunk renderChunk;      /// Mesh of the chunk, until it is uploaded.
+   ChunkGL gl;                   /// Uploaded mesh of the chunk.
+   bool ready;                   /// Main thread only. Set once the chunk is first uploaded, its cubes are final from then on.
+   bool dirty;                   /// Main thread only. Edited since the last flushWorldEdits, see chunkPipeline.h.
+   ChunkColumn *column;          /// The column this chunk is part of.
+   S8 heightmap[CHUNK_WIDTH * CHUNK_WIDTH]; /// Highest non-air local y of each column, -1 if it is all air. See getColumnIndex.
+   struct Chunk *neighbours[ChunkNeighbour_Count]; /// Loaded neighbouring chunks, NULL if not loaded.
+   U8 *caveDensity;              /// Cached cave noise while the chunk is being carved, NULL otherwise. See worldGen.c.
+} Chunk;
+
+/// Every loaded chunk, keyed by getChunkKey. The world can be any size and
+/// shape; missing chunks are simply not loaded.
+extern HashMap gChunkMap;
+
+/// Every column with at least one loaded chunk, keyed by getChunkColumnKey.
+extern HashMap gChunkColumnMap;
+
+/// Packs chunk coordinates into a key. Each coordinate keeps its low 21 bits
+/// which is over a million chunks in each direction.
+static inline U64 getChunkKey(S32 x, S32 y, S32 z) {
+   return (((U64)(U32)x & 0x1FFFFF) << 42) | (((U64)(U32)y & 0x1FFFFF) << 21) | ((U64)(U32)z & 0x1FFFFF);
+}
+
+static inline U64 getChunkColumnKey(S32 x, S32 z) {
+   return ((U64)(U32)x << 32) | (U64)(U32)z;
+}
+
+/// @return The chunk at chunk coordinates x, y, z or NULL if it isn't loaded.
+Chunk* getChunkAt(S32 x, S32 y, S32 z);
+
+/// Adds a chunk to gChunkMap at its startX, startY, startZ, links it up
+/// with its loaded neighbours and attaches it to its column.
+/// @param chunk The chunk to add.
+void insertChunk(Chunk *chunk);
+
+/// Removes a chunk from gChunkMap, unlinks it from its neighbours and
+/// releases its column.
+/// @param chunk The chunk to remove.
+void removeChunk(Chunk *chunk);
+
+/// Fills the chunk with a single material and resets its heightmap.
+/// @param chunk The chunk to initialize. Its section must not own storage.
+/// @param fill The material to fill the chunk with.
+void initChunkCubes(Chunk *chunk, Material fill);
+
+/// Finds the highest non-air cube in a column by scanning downwards.
+/// @param chunk The chunk to search.
+/// @param x The local x position of the column.
+/// @param fromY The local y position to start scanning down from.
+/// @param z The local z position of the column.
+/// @return The local y position of the highest non-air cube at or below
+///         fromY, or -1 if there is none.
+S32 scanColumnHeight(Chunk *chunk, S32 x, S32 fromY, S32 z);
+
+static inline S32 getColumnIndex(S32 x, S32 z) {
+   return x * CHUNK_WIDTH + z;
+}
+
+/// @return The local y position of the highest non-air cube in the column of
+///         the chunk, or -1 if the column is all air.
+static inline S32 getColumnHeight(const Chunk *chunk, S32 x, S32 z) {
+   return chunk->heightmap[getColumnIndex(x, z)];
+}
+
+static inline Cube getCubeAt(Chunk *chunk, S32 x, S32 y, S32 z) {
+   return getSectionCube(&chunk->section, x, y, z);
+}
+
+/// Every cube write must go through here to keep the heightmap up to date.
+static inline void setCubeAt(Chunk *chunk, S32 x, S32 y, S32 z, Material material) {
+   setSectionCube(&chunk->section, x, y, z, createCube(material));
+
+   S8 *height = &chunk->heightmap[getColumnIndex(x, z)];
+   if (material != Material_Air) {
+      if (y > *height)
+         *height = (S8)y;
+   } else if (y == *height) {
+      // The top of the column was removed. The next cube down is almost
+      // always right below it.
+      *height = (S8)scanColumnHeight(chunk, x, y - 1, z);
+   }
+}
+
+static inline bool isTransparent(Chunk *chunk, S32 x, S32 y, S32 z) {
+   assert(chunk);
+   return getCubeAt(chunk, x, y, z).material == Material_Air;
+}
+
+/// Converts a world space position on one axis into a chunk coordinate,
+/// rounding towards negative infinity.
+static inline S32 getChunkCoordinate(S32 position, S32 chunkSize) {
+   return position < 0 ? ((position + 1) / chunkSize) - 1 : position / chunkSize;
+}
+
+static inline Chunk* getChunkAtWorldSpacePosition(S32 x, S32 y, S32 z) {
+   return getChunkAt(getChunkCoordinate(x, CHUNK_WIDTH), getChunkCoordinate(y, CHUNK_HEIGHT), getChunkCoordinate(z, CHUNK_WIDTH));
+}
+
+static inline bool getGlobalCubeAtWorldSpacePosition(S32 x, S32 y, S32 z, Cube *cube) {
+   // first calculate chunk based upon position.
+   S32 chunkX = getChunkCoordinate(x, CHUNK_WIDTH);
+   S32 chunkY = getChunkCoordinate(y, CHUNK_HEIGHT);
+   S32 chunkZ = getChunkCoordinate(z, CHUNK_WIDTH);
+
+   // Don't go past.
+   Chunk *chunk = getChunkAt(chunkX, chunkY, chunkZ);
+   if (chunk == NULL)
+      return false;
+
+   S32 localChunkX = x - (chunkX * CHUNK_WIDTH);
+   S32 localChunkY = y - (chunkY * CHUNK_HEIGHT);
+   S32 localChunkZ = z - (chunkZ * CHUNK_WIDTH);
+
+   assert(localChunkX >= 0);
+   assert(localChunkY >= 0);
+   assert(localChunkZ >= 0);
+   assert(localChunkX < CHUNK_WIDTH);
+   assert(localChunkY < CHUNK_HEIGHT);
+   assert(localChunkZ < CHUNK_WIDTH);
+
+   *cube = getCubeAt(chunk, localChunkX, localChunkY, localChunkZ);
+   return true;
+}
+
+/// Cubes outside of the loaded world are treated as solid.
+static inline bool isTransparentAtWorldSpacePosition(S32 x, S32 y, S32 z) {
+   Cube cube;
+   if (!getGlobalCubeAtWorldSpacePosition(x, y, z, &cube))
+      return false;
+   return cube.material == Material_Air;
+}
+
+#endif
@@ -0,0 +1,500 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game/chunkPipeline.h"
+#include "game/mesher.h"
+#include "game/worldGen.h"
+#include "platform/thread.h"
+
+typedef enum PipelineJobType {
+   PipelineJobType_None,
+   PipelineJobType_Column,
+   PipelineJobType_Chunk
+} PipelineJobType;
+
+typedef struct PipelineJob {
+   PipelineJobType type;
+   Chunk *chunk; /// The chunk the job is for. Column jobs use its column.
+   F64 seconds;  /// How long the job took, 0 unless the pipeline has a clock.
+} PipelineJob;
+
+typedef struct ChunkPipeline {
+   Mutex *mutex;                  /// Guards everything below and the busy and status fields of queued chunks.
+   ConditionVariable *condition;  /// Signaled when a job finishes or the queue changes.
+   Thread **workers;
+   S32 workerCount;
+   bool quit;
+   bool paused;                   /// Don't hand out new jobs.
+   S32 runningCount;              /// Number of jobs running right now.
+   ChunkStatus targetStatus;      /// Chunks are finished once they reach this status.
+   ChunkPipelineClock clock;      /// Times the jobs, NULL if they aren't timed.
+   ChunkPipelineStats stats;
+
+   Chunk **queue;                 /// Chunks that haven't reached targetStatus, in the order they should be generated.
+   Chunk **sortedQueue;           /// Scratch space for prioritizeChunkPipeline, only touched by the thread that queues chunks.
+   F32 *priorities;
+   S32 queueCount;
+   S32 queueCapacity;
+
+   Chunk **finished;              /// Finished chunks waiting for collectFinishedChunks.
+   S32 finishedCount;
+   S32 finishedCapacity;
+
+   bool editing;                  /// Paused by beginWorldEdit until flushWorldEdits. Main thread only, like the rest below.
+   Chunk **edited;                /// Chunks flagged by markChunkDirty. Each is listed once.
+   S32 editedCount;
+   S32 editedCapacity;
+} ChunkPipeline;
+
+static ChunkPipeline gPipeline;
+
+static S32 findChunkInList(Chunk **list, S32 count, const Chunk *chunk) {
+   for (S32 i = 0; i < count; ++i) {
+      if (list[i] == chunk)
+         return i;
+   }
+   return -1;
+}
+
+// Removes a chunk from a list keeping the order of the rest.
+static void removeChunkFromList(Chunk **list, S32 *count, const Chunk *chunk) {
+   S32 index = findChunkInList(list, *count, chunk);
+   if (index == -1)
+      return;
+
+   (*count)--;
+   memmove(&list[index], &list[index + 1], sizeof(Chunk*) * (*count - index));
+}
+
+static void reserveQueue(S32 count) {
+   if (count <= gPipeline.queueCapacity)
+      return;
+
+   gPipeline.queueCapacity = count > gPipeline.queueCapacity * 2 ? count : gPipeline.queueCapacity * 2;
+   gPipeline.queue = (Chunk**)realloc(gPipeline.queue, sizeof(Chunk*) * gPipeline.queueCapacity);
+   gPipeline.sortedQueue = (Chunk**)realloc(gPipeline.sortedQueue, sizeof(Chunk*) * gPipeline.queueCapacity);
+   gPipeline.priorities = (F32*)realloc(gPipeline.priorities, sizeof(F32) * gPipeline.queueCapacity);
+}
+
+static void reserveFinished(S32 count) {
+   if (count <= gPipeline.finishedCapacity)
+      return;
+
+   gPipeline.finishedCapacity = count > gPipeline.finishedCapacity * 2 ? count : gPipeline.finishedCapacity * 2;
+   gPipeline.finished = (Chunk**)realloc(gPipeline.finished, sizeof(Chunk*) * gPipeline.finishedCapacity);
+}
+
+static void reserveEdited(S32 count) {
+   if (count <= gPipeline.editedCapacity)
+      return;
+
+   gPipeline.editedCapacity = count > gPipeline.editedCapacity * 2 ? count : gPipeline.editedCapacity * 2;
+   gPipeline.edited = (Chunk**)realloc(gPipeline.edited, sizeof(Chunk*) * gPipeline.editedCapacity);
+}
+
+static inline bool isChunkAtLeast(const Chunk *chunk, ChunkStatus status) {
+   return chunk == NULL || chunk->status >= status;
+}
+
+static bool canCarveChunk(const Chunk *chunk) {
+   for (S32 i = 0; i < ChunkNeighbour_Count; ++i) {
+      const Chunk *neighbour = chunk->neighbours[i];
+      if (neighbour != NULL && (neighbour->busy || neighbour->status < ChunkStatus_Terrain))
+         return false;
+   }
+   return true;
+}
+
+static inline bool isNeighbourhoodAtLeast(const Chunk *chunk, ChunkStatus status) {
+   for (S32 i = 0; i < ChunkNeighbour_Count; ++i) {
+      if (!isChunkAtLeast(chunk->neighbours[i], status))
+         return false;
+   }
+   return true;
+}
+
+// Finds the first job in the queue that can run and claims it. Must be
+// called with the mutex held.
+static bool findPipelineJob(PipelineJob *job) {
+   if (gPipeline.paused)
+      return false;
+
+   for (S32 i = 0; i < gPipeline.queueCount; ++i) {
+      Chunk *chunk = gPipeline.queue[i];
+      if (chunk->busy)
+         continue;
+
+      bool ready = false;
+      switch (chunk->status) {
+         case ChunkStatus_Empty:
+            // Don't look at hasTerrain while the column is being generated.
+            if (chunk->column->busy)
+               break;
+            if (!chunk->column->hasTerrain) {
+               chunk->column->busy = true;
+               gPipeline.runningCount++;
+               job->type = PipelineJobType_Column;
+               job->chunk = chunk;
+               return true;
+            }
+            ready = true;
+            break;
+         case ChunkStatus_Terrain:
+            ready = canCarveChunk(chunk);
+            break;
+         case ChunkStatus_Carved:
+            ready = isNeighbourhoodAtLeast(chunk, ChunkStatus_Carved);
+            break;
+         case ChunkStatus_Decorated:
+            ready = isNeighbourhoodAtLeast(chunk, ChunkStatus_Decorated);
+            break;
+         case ChunkStatus_Meshed:
+            break;
+      }
+
+      if (ready) {
+         chunk->busy = true;
+         gPipeline.runningCount++;
+         job->type = PipelineJobType_Chunk;
+         job->chunk = chunk;
+         return true;
+      }
+   }
+   return false;
+}
+
+static void generatePipelineJob(const PipelineJob *job) {
+   Chunk *chunk = job->chunk;
+   if (job->type == PipelineJobType_Column) {
+      generateColumnTerrain(chunk->column);
+      return;
+   }
+
+   switch (chunk->status) {
+      case ChunkStatus_Empty:
+         generateWorld(chunk);
+         break;
+      case ChunkStatus_Terrain:
+         generateCaves(chunk);
+         break;
+      case ChunkStatus_Carved:
+         generateStructures(chunk);
+         break;
+      case ChunkStatus_Decorated:
+         generateGeometry(chunk);
+         break;
+      case ChunkStatus_Meshed:
+         break;
+   }
+}
+
+// Runs a job without holding the mutex. The clock is only changed while
+// nothing runs.
+static void runPipelineJob(PipelineJob *job) {
+   if (gPipeline.clock == NULL) {
+      generatePipelineJob(job);
+      job->seconds = 0.0;
+      return;
+   }
+
+   F64 start = gPipeline.clock();
+   generatePipelineJob(job);
+   job->seconds = gPipeline.clock() - start;
+}
+
+// Must be called with the mutex held.
+static void finishPipelineJob(const PipelineJob *job) {
+   Chunk *chunk = job->chunk;
+   gPipeline.runningCount--;
+   if (job->type == PipelineJobType_Column) {
+      chunk->column->busy = false;
+      gPipeline.stats.columnSeconds += job->seconds;
+      gPipeline.stats.columnCount++;
+   } else {
+      chunk->status = (ChunkStatus)(chunk->status + 1);
+      chunk->busy = false;
+      gPipeline.stats.stageSeconds[chunk->status] += job->seconds;
+      gPipeline.stats.stageCount[chunk->status]++;
+      if (chunk->status == gPipeline.targetStatus) {
+         removeChunkFromList(gPipeline.queue, &gPipeline.queueCount, chunk);
+         reserveFinished(gPipeline.finishedCount + 1);
+         gPipeline.finished[gPipeline.finishedCount++] = chunk;
+      }
+   }
+
+   // Finishing a job can make jobs on the chunks around it ready, and lets
+   // a pause go ahead.
+   broadcastConditionVariable(gPipeline.condition);
+}
+
+static void pipelineWorker(void *userData) {
+   (void)userData;
+
+   lockMutex(gPipeline.mutex);
+   while (!gPipeline.quit) {
+      PipelineJob job;
+      if (!findPipelineJob(&job)) {
+         waitConditionVariable(gPipeline.condition, gPipeline.mutex);
+         continue;
+      }
+
+      unlockMutex(gPipeline.mutex);
+      runPipelineJob(&job);
+      lockMutex(gPipeline.mutex);
+      finishPipelineJob(&job);
+   }
+   unlockMutex(gPipeline.mutex);
+}
+
+void initChunkPipeline(S32 workerCount) {
+   if (workerCount < 0) {
+      workerCount = getProcessorCount() - 1;
+      if (workerCount < 1)
+         workerCount = 1;
+   }
+
+   memset(&gPipeline, 0, sizeof(ChunkPipeline));
+   gPipeline.targetStatus = ChunkStatus_Meshed;
+   gPipeline.mutex = createMutex();
+   gPipeline.condition = createConditionVariable();
+   gPipeline.workers = (Thread**)calloc(workerCount > 0 ? workerCount : 1, sizeof(Thread*));
+   for (S32 i = 0; i < workerCount; ++i) {
+      Thread *thread = createThread(pipelineWorker, NULL);
+      if (thread == NULL)
+         break;
+      gPipeline.workers[gPipeline.workerCount++] = thread;
+   }
+}
+
+void freeChunkPipeline() {
+   lockMutex(gPipeline.mutex);
+   gPipeline.quit = true;
+   broadcastConditionVariable(gPipeline.condition);
+   unlockMutex(gPipeline.mutex);
+
+   for (S32 i = 0; i < gPipeline.workerCount; ++i)
+      joinThread(gPipeline.workers[i]);
+   free(gPipeline.workers);
+   free(gPipeline.queue);
+   free(gPipeline.sortedQueue);
+   free(gPipeline.priorities);
+   free(gPipeline.finished);
+   free(gPipeline.edited);
+
+   freeConditionVariable(gPipeline.condition);
+   freeMutex(gPipeline.mutex);
+   memset(&gPipeline, 0, sizeof(ChunkPipeline));
+}
+
+void pauseChunkPipeline() {
+   lockMutex(gPipeline.mutex);
+   assert(!gPipeline.paused);
+   gPipeline.paused = true;
+   while (gPipeline.runningCount > 0)
+      waitConditionVariable(gPipeline.condition, gPipeline.mutex);
+   unlockMutex(gPipeline.mutex);
+}
+
+void resumeChunkPipeline() {
+   lockMutex(gPipeline.mutex);
+   gPipeline.paused = false;
+   broadcastConditionVariable(gPipeline.condition);
+   unlockMutex(gPipeline.mutex);
+}
+
+// Must be called with the mutex held.
+static void queueChunk(Chunk *chunk) {
+   removeChunkFromList(gPipeline.finished, &gPipeline.finishedCount, chunk);
+   if (chunk->status >= gPipeline.targetStatus || findChunkInList(gPipeline.queue, gPipeline.queueCount, chunk) != -1)
+      return;
+
+   reserveQueue(gPipeline.queueCount + 1);
+   gPipeline.queue[gPipeline.queueCount++] = chunk;
+}
+
+void addChunkToPipeline(Chunk *chunk) {
+   lockMutex(gPipeline.mutex);
+   assert(gPipeline.paused);
+   queueChunk(chunk);
+   unlockMutex(gPipeline.mutex);
+}
+
+void removeChunkFromPipeline(Chunk *chunk) {
+   lockMutex(gPipeline.mutex);
+   assert(gPipeline.paused);
+   removeChunkFromList(gPipeline.queue, &gPipeline.queueCount, chunk);
+   removeChunkFromList(gPipeline.finished, &gPipeline.finishedCount, chunk);
+   unlockMutex(gPipeline.mutex);
+}
+
+void beginWorldEdit() {
+   if (!gPipeline.editing) {
+      pauseChunkPipeline();
+      gPipeline.editing = true;
+   }
+}
+
+void markChunkDirty(Chunk *chunk) {
+   assert(gPipeline.editing);
+   if (chunk == NULL || chunk->dirty)
+      return;
+   chunk->dirty = true;
+   reserveEdited(gPipeline.editedCount + 1);
+   gPipeline.edited[gPipeline.editedCount++] = chunk;
+}
+
+S32 flushWorldEdits() {
+   if (!gPipeline.editing)
+      return 0;
+
+   // Meshed chunks go back a step, the rest are still on their way and
+   // mesh the edited cubes anyway. The old mesh is drawn until the new one
+   // is uploaded.
+   S32 remeshed = 0;
+   lockMutex(gPipeline.mutex);
+   for (S32 i = 0; i < gPipeline.editedCount; ++i) {
+      Chunk *chunk = gPipeline.edited[i];
+      chunk->dirty = false;
+      if (chunk->status == ChunkStatus_Meshed) {
+         chunk->status = ChunkStatus_Decorated;
+         queueChunk(chunk);
+         remeshed++;
+      }
+   }
+   gPipeline.editedCount = 0;
+   unlockMutex(gPipeline.mutex);
+
+   gPipeline.editing = false;
+   resumeChunkPipeline();
+   return remeshed;
+}
+
+void setChunkPipelineTarget(ChunkStatus status) {
+   lockMutex(gPipeline.mutex);
+   assert(gPipeline.queueCount == 0);
+   gPipeline.targetStatus = status;
+   unlockMutex(gPipeline.mutex);
+}
+
+void setChunkPipelineClock(ChunkPipelineClock clock) {
+   lockMutex(gPipeline.mutex);
+   assert(gPipeline.runningCount == 0);
+   gPipeline.clock = clock;
+   memset(&gPipeline.stats, 0, sizeof(ChunkPipelineStats));
+   unlockMutex(gPipeline.mutex);
+}
+
+void getChunkPipelineStats(ChunkPipelineStats *stats) {
+   lockMutex(gPipeline.mutex);
+   *stats = gPipeline.stats;
+   unlockMutex(gPipeline.mutex);
+}
+
+void prioritizeChunkPipeline(ChunkPriorityFunction priority, void *userData) {
+   // Only this thread adds chunks to the queue, the workers only take the
+   // finished ones out. So a copy can be sorted without holding the lock,
+   // and swapped back in minus whatever finished in the meantime.
+   lockMutex(gPipeline.mutex);
+   S32 count = gPipeline.queueCount;
+   memcpy(gPipeline.sortedQueue, gPipeline.queue, sizeof(Chunk*) * count);
+   unlockMutex(gPipeline.mutex);
+
+   Chunk **sorted = gPipeline.sortedQueue;
+   F32 *priorities = gPipeline.priorities;
+   for (S32 i = 0; i < count; ++i)
+      priorities[i] = priority(sorted[i], userData);
+
+   // The order barely changes from one call to the next, so an insertion
+   // sort is close to a single pass.
+   for (S32 i = 1; i < count; ++i) {
+      Chunk *chunk = sorted[i];
+      F32 chunkPriority = priorities[i];
+      S32 j = i;
+      while (j > 0 && priorities[j - 1] > chunkPriority) {
+         sorted[j] = sorted[j - 1];
+         priorities[j] = priorities[j - 1];
+         j--;
+      }
+      sorted[j] = chunk;
+      priorities[j] = chunkPriority;
+   }
+
+   lockMutex(gPipeline.mutex);
+   S32 queueCount = 0;
+   for (S32 i = 0; i < count; ++i) {
+      if (sorted[i]->status < gPipeline.targetStatus)
+         gPipeline.queue[queueCount++] = sorted[i];
+   }
+   assert(queueCount == gPipeline.queueCount);
+   gPipeline.queueCount = queueCount;
+   unlockMutex(gPipeline.mutex);
+}
+
+S32 collectFinishedChunks(Chunk **chunks, S32 maxCount) {
+   lockMutex(gPipeline.mutex);
+   S32 count = gPipeline.finishedCount < maxCount ? gPipeline.finishedCount : maxCount;
+   memcpy(chunks, gPipeline.finished, sizeof(Chunk*) * count);
+   gPipeline.finishedCount -= count;
+   memmove(gPipeline.finished, &gPipeline.finished[count], sizeof(Chunk*) * gPipeline.finishedCount);
+   unlockMutex(gPipeline.mutex);
+   return count;
+}
+
+S32 getChunkPipelineQueueCount() {
+   lockMutex(gPipeline.mutex);
+   S32 count = gPipeline.queueCount;
+   unlockMutex(gPipeline.mutex);
+   return count;
+}
+
+// Must be called with the mutex held.
+static void helpChunkPipeline() {
+   while (gPipeline.queueCount > 0) {
+      PipelineJob job;
+      if (!findPipelineJob(&job)) {
+         waitConditionVariable(gPipeline.condition, gPipeline.mutex);
+         continue;
+      }
+
+      unlockMutex(gPipeline.mutex);
+      runPipelineJob(&job);
+      lockMutex(gPipeline.mutex);
+      finishPipelineJob(&job);
+   }
+}
+
+void waitForChunkPipeline() {
+   lockMutex(gPipeline.mutex);
+   assert(!gPipeline.paused);
+   helpChunkPipeline();
+   unlockMutex(gPipeline.mutex);
+}
+
+void runChunkPipeline(Chunk **chunks, S32 count) {
+   lockMutex(gPipeline.mutex);
+   assert(gPipeline.queueCount == 0 && !gPipeline.paused);
+   for (S32 i = 0; i < count; ++i)
+      queueChunk(chunks[i]);
+   broadcastConditionVariable(gPipeline.condition);
+
+   // Help out until every chunk is finished. Nobody collects the batch.
+   helpChunkPipeline();
+   gPipeline.finishedCount = 0;
+   unlockMutex(gPipeline.mutex);
+}
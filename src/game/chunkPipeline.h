@@ -0,0 +1,146 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _GAME_CHUNKPIPELINE_H_
+#define _GAME_CHUNKPIPELINE_H_
+
+#include "game/chunk.h"
+
+/// Generates chunks on every core. Each chunk steps through ChunkStatus one
+/// job at a time, and a job only runs once the chunks around it are far
+/// enough along that the result is the same as generating every chunk one
+/// after another:
+///
+/// Terrain:   The column's terrain heights are generated, once per column.
+/// Carved:    The 6 neighbours have their terrain. Cave smoothing reads
+///            them, so no neighbour may be carving at the same time.
+/// Decorated: The 6 neighbours are carved, as carving reads this chunk.
+///            Every chunk plants its own part of the trees that cross into
+///            it, so chunks are decorated independently of each other.
+/// Meshed:    This chunk and its 6 neighbours are decorated, so none of
+///            their cubes can change.
+///
+/// Unloaded neighbours never hold anything up.
+///
+/// Chunks are queued from the main thread and generated in the background.
+/// Chunks that are finished, meshed unless setChunkPipelineTarget says
+/// otherwise, are handed back with collectFinishedChunks for the GL upload.
+
+/// How soon a chunk should be generated, lower first.
+typedef F32 (*ChunkPriorityFunction)(const Chunk *chunk, void *userData);
+
+/// Returns a timestamp in seconds, used to time the pipeline's jobs.
+typedef F64 (*ChunkPipelineClock)();
+
+/// Time spent in each kind of job, summed over every thread.
+typedef struct ChunkPipelineStats {
+   F64 columnSeconds;                           /// Column terrain heights and tree roots.
+   U32 columnCount;
+   F64 stageSeconds[ChunkStatus_Meshed + 1];    /// Time spent reaching each status, indexed by ChunkStatus.
+   U32 stageCount[ChunkStatus_Meshed + 1];
+} ChunkPipelineStats;
+
+/// Starts the worker threads.
+/// @param workerCount The number of threads to start besides the thread
+///        that runs the pipeline, or -1 for one less than the processor
+///        count but at least one, so chunks are always generated in the
+///        background.
+void initChunkPipeline(S32 workerCount);
+
+/// Stops the worker threads. Chunks still queued are dropped.
+void freeChunkPipeline();
+
+/// Stops handing out jobs and waits for the running ones to finish. The
+/// queued chunks, their neighbours and gChunkMap can then be changed until
+/// resumeChunkPipeline. Jobs are short, so this doesn't wait long.
+void pauseChunkPipeline();
+
+/// Lets the workers continue after pauseChunkPipeline.
+void resumeChunkPipeline();
+
+/// Sets how far chunks are generated. The default is ChunkStatus_Meshed.
+/// Only call while nothing is queued.
+/// @param status Chunks are finished once they reach this status.
+void setChunkPipelineTarget(ChunkStatus status);
+
+/// Times every job from now on, or stops timing them. Resets the stats.
+/// Only call while no jobs are running.
+/// @param clock The clock to time jobs with, or NULL to not time them.
+void setChunkPipelineClock(ChunkPipelineClock clock);
+
+/// @param stats Filled with the time spent since setChunkPipelineClock.
+void getChunkPipelineStats(ChunkPipelineStats *stats);
+
+/// Queues a chunk to be generated and meshed in the background. Chunks
+/// that are already queued or finished are left alone. Only call while the
+/// pipeline is paused.
+/// @param chunk The chunk to generate. It must already be in gChunkMap.
+void addChunkToPipeline(Chunk *chunk);
+
+/// Drops a chunk from the pipeline, whether it is queued or finished and
+/// waiting to be collected. Only call while the pipeline is paused.
+/// @param chunk The chunk that is being unloaded.
+void removeChunkFromPipeline(Chunk *chunk);
+
+/// Pauses the pipeline so cubes can be edited. It stays paused until
+/// flushWorldEdits, so a whole batch of edits costs one pause. Does nothing
+/// if a batch is already open.
+void beginWorldEdit();
+
+/// Flags an edited chunk to be remeshed by the next flushWorldEdits. Only
+/// call between beginWorldEdit and flushWorldEdits.
+/// @param chunk The edited chunk, or NULL for a neighbour that isn't loaded.
+void markChunkDirty(Chunk *chunk);
+
+/// Sends every chunk flagged since beginWorldEdit back to be remeshed, once
+/// no matter how many of its cubes changed, and lets the pipeline continue.
+/// Does nothing if no batch is open.
+/// @return The number of chunks sent back to be remeshed.
+S32 flushWorldEdits();
+
+/// Reorders the queue. Jobs are handed out in queue order, as soon as the
+/// chunks around them allow it. Call from the thread that queues chunks.
+/// The priorities are worked out while the workers keep going, so they
+/// aren't held up by a long queue.
+/// @param priority Called for every queued chunk, lower is generated first.
+///        Jobs may be running on the chunk, so it should only read the
+///        chunk's position.
+/// @param userData Passed to priority.
+void prioritizeChunkPipeline(ChunkPriorityFunction priority, void *userData);
+
+/// Hands back chunks that have been finished since the last call.
+/// @param chunks Filled with the finished chunks.
+/// @param maxCount The size of chunks.
+/// @return The number of chunks written to chunks.
+S32 collectFinishedChunks(Chunk **chunks, S32 maxCount);
+
+/// @return The number of chunks that are queued and not finished yet.
+S32 getChunkPipelineQueueCount();
+
+/// Runs jobs on the calling thread until every queued chunk is finished.
+void waitForChunkPipeline();
+
+/// Generates and meshes a batch of chunks. Returns once every chunk in the
+/// batch is finished. The calling thread runs jobs too. Nothing else may be
+/// queued.
+///
+/// The chunks and their neighbours must already be in gChunkMap and must
+/// not be touched by anything else until this returns.
+/// @param chunks The chunks to bring up to the target status.
+/// @param count The number of chunks.
+void runChunkPipeline(Chunk **chunks, S32 count);
+
+#endif
@@ -0,0 +1,234 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "base/pool.h"
+#include "game/chunkSection.h"
+#include "platform/thread.h"
+
+#define SECTION_INDEX_WIDTHS 5
+
+/// Section storage comes out of one pool per index width (1, 2, 4, 8 and 16
+/// bits) so that chunks streaming in and out reuse the same blocks instead
+/// of going back to the heap. Palettes are pooled the same way.
+static Pool gSectionDataPools[SECTION_INDEX_WIDTHS];
+static Pool gSectionPalettePools[SECTION_INDEX_WIDTHS - 1];
+
+/// Chunks are generated on several threads at once. Guards both pool arrays.
+static Mutex *gSectionPoolMutex = NULL;
+
+static inline WordSize getSectionDataSize(U32 bitsPerIndex) {
+   return (WordSize)(SECTION_VOLUME * bitsPerIndex / 8);
+}
+
+static inline WordSize getSectionPaletteSize(U32 bitsPerIndex) {
+   return sizeof(U16) * ((WordSize)1 << bitsPerIndex);
+}
+
+void initChunkSectionPools() {
+   gSectionPoolMutex = createMutex();
+   for (U32 i = 0; i < SECTION_INDEX_WIDTHS; ++i) {
+      // Roughly 64 KB slabs.
+      WordSize size = getSectionDataSize(1U << i);
+      initPool(&gSectionDataPools[i], size, (U32)(65536 / size));
+   }
+   for (U32 i = 0; i < SECTION_INDEX_WIDTHS - 1; ++i)
+      initPool(&gSectionPalettePools[i], getSectionPaletteSize(1U << i), 256);
+}
+
+void freeChunkSectionPools() {
+   for (U32 i = 0; i < SECTION_INDEX_WIDTHS; ++i)
+      freePool(&gSectionDataPools[i]);
+   for (U32 i = 0; i < SECTION_INDEX_WIDTHS - 1; ++i)
+      freePool(&gSectionPalettePools[i]);
+   freeMutex(gSectionPoolMutex);
+   gSectionPoolMutex = NULL;
+}
+
+void getChunkSectionPoolStats(PoolStats *stats) {
+   memset(stats, 0, sizeof(PoolStats));
+   for (U32 i = 0; i < SECTION_INDEX_WIDTHS; ++i)
+      poolStatsAdd(stats, &gSectionDataPools[i].stats);
+   for (U32 i = 0; i < SECTION_INDEX_WIDTHS - 1; ++i)
+      poolStatsAdd(stats, &gSectionPalettePools[i].stats);
+}
+
+static inline U64* allocSectionData(U32 bitsPerIndex) {
+   lockMutex(gSectionPoolMutex);
+   U64 *data = (U64*)poolAlloc(&gSectionDataPools[getIndexWidthShift(bitsPerIndex)]);
+   unlockMutex(gSectionPoolMutex);
+   memset(data, 0, getSectionDataSize(bitsPerIndex));
+   return data;
+}
+
+static inline U16* allocSectionPalette(U32 bitsPerIndex) {
+   lockMutex(gSectionPoolMutex);
+   U16 *palette = (U16*)poolAlloc(&gSectionPalettePools[getIndexWidthShift(bitsPerIndex)]);
+   unlockMutex(gSectionPoolMutex);
+   return palette;
+}
+
+static inline void freeSectionStorage(U32 bitsPerIndex, U64 *data, U16 *palette) {
+   U32 shift = getIndexWidthShift(bitsPerIndex);
+   lockMutex(gSectionPoolMutex);
+   poolFree(&gSectionDataPools[shift], data);
+   if (palette != NULL)
+      poolFree(&gSectionPalettePools[shift], palette);
+   unlockMutex(gSectionPoolMutex);
+}
+
+static inline void setSectionEntry(ChunkSection *section, S32 index, U32 value) {
+   U32 shift = getSectionIndexShift(section);
+   U32 entriesPerWordShift = 6 - shift;
+   U64 *word = &section->data[index >> entriesPerWordShift];
+   U32 bitOffset = (U32)(index & ((1 << entriesPerWordShift) - 1)) << shift;
+   U64 mask = (U64)((1U << section->bitsPerIndex) - 1U) << bitOffset;
+   *word = (*word & ~mask) | ((U64)value << bitOffset);
+}
+
+void initChunkSection(ChunkSection *section, Cube fill) {
+   memset(section, 0, sizeof(ChunkSection));
+   section->uniform = packCube(fill);
+   section->solidCount = fill.material == Material_Air ? 0 : SECTION_VOLUME;
+}
+
+void freeChunkSection(ChunkSection *section) {
+   if (section->bitsPerIndex != 0)
+      freeSectionStorage(section->bitsPerIndex, section->data, section->palette);
+   memset(section, 0, sizeof(ChunkSection));
+}
+
+static void resizeSection(ChunkSection *section, U32 newBits) {
+   ChunkSection old = *section;
+
+   section->bitsPerIndex = (U8)newBits;
+   section->data = allocSectionData(newBits);
+
+   if (newBits == SECTION_DIRECT_BITS) {
+      // Past 8 bits the palette costs more than it saves. Store the packed
+      // cubes themselves.
+      for (S32 i = 0; i < SECTION_VOLUME; ++i)
+         setSectionEntry(section, i, old.palette[getSectionEntry(&old, i)]);
+      section->palette = NULL;
+      section->paletteCount = 0;
+   } else {
+      for (S32 i = 0; i < SECTION_VOLUME; ++i)
+         setSectionEntry(section, i, getSectionEntry(&old, i));
+      section->palette = allocSectionPalette(newBits);
+      memcpy(section->palette, old.palette, sizeof(U16) * old.paletteCount);
+   }
+
+   if (old.bitsPerIndex != 0)
+      freeSectionStorage(old.bitsPerIndex, old.data, old.palette);
+}
+
+static inline U16 getSectionPackedCube(const ChunkSection *section, S32 index) {
+   U32 entry = getSectionEntry(section, index);
+   return section->palette != NULL ? section->palette[entry] : (U16)entry;
+}
+
+// Drops the storage of a section if every cube inside of it is the same.
+// Only called when the solid count hits 0 or SECTION_VOLUME, so the full scan
+// is rare.
+static void collapseSectionIfUniform(ChunkSection *section) {
+   U32 first = getSectionEntry(section, 0);
+   for (S32 i = 1; i < SECTION_VOLUME; ++i) {
+      if (getSectionEntry(section, i) != first)
+         return;
+   }
+
+   U16 uniform = section->palette != NULL ? section->palette[first] : (U16)first;
+   U16 solidCount = section->solidCount;
+   freeChunkSection(section);
+   section->uniform = uniform;
+   section->solidCount = solidCount;
+}
+
+static void writeSectionCube(ChunkSection *section, S32 index, U16 packed) {
+   if (section->palette != NULL) {
+      // Find the cube inside of the palette. Palettes are tiny so a linear
+      // search is faster than anything fancier.
+      U32 entry = 0;
+      for (; entry < section->paletteCount; ++entry) {
+         if (section->palette[entry] == packed)
+            break;
+      }
+
+      if (entry == section->paletteCount) {
+         if (section->paletteCount == (1U << section->bitsPerIndex))
+            resizeSection(section, section->bitsPerIndex == 8 ? SECTION_DIRECT_BITS : section->bitsPerIndex * 2);
+
+         // Resizing might have switched us to direct storage.
+         if (section->palette != NULL)
+            section->palette[section->paletteCount++] = packed;
+      }
+
+      if (section->palette != NULL) {
+         setSectionEntry(section, index, entry);
+         return;
+      }
+   }
+
+   setSectionEntry(section, index, packed);
+}
+
+void setSectionCube(ChunkSection *section, S32 x, S32 y, S32 z, Cube cube) {
+   U16 packed = packCube(cube);
+   S32 index = getSectionIndex(x, y, z);
+
+   U16 old;
+   if (section->bitsPerIndex == 0) {
+      if (section->uniform == packed)
+         return;
+
+      // First differing cube, we need real storage now.
+      old = section->uniform;
+      section->bitsPerIndex = 1;
+      section->paletteCount = 1;
+      section->palette = allocSectionPalette(1);
+      section->palette[0] = old;
+      section->data = allocSectionData(1);
+   } else {
+      old = getSectionPackedCube(section, index);
+      if (old == packed)
+         return;
+   }
+
+   writeSectionCube(section, index, packed);
+
+   bool wasSolid = unpackCube(old).material != Material_Air;
+   bool isSolid = cube.material != Material_Air;
+   if (wasSolid != isSolid) {
+      if (isSolid)
+         section->solidCount++;
+      else
+         section->solidCount--;
+
+      if (section->solidCount == 0 || section->solidCount == SECTION_VOLUME)
+         collapseSectionIfUniform(section);
+   }
+}
+
+WordSize getChunkSectionMemoryUsage(const ChunkSection *section) {
+   if (section->bitsPerIndex == 0)
+      return 0;
+
+   WordSize size = getSectionDataSize(section->bitsPerIndex);
+   if (section->palette != NULL)
+      size += getSectionPaletteSize(section->bitsPerIndex);
+   return size;
+}
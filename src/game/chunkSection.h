@@ -0,0 +1,190 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _GAME_CHUNKSECTION_H_
+#define _GAME_CHUNKSECTION_H_
+
+#include <assert.h>
+#include "base/pool.h"
+#include "game/cube.h"
+
+#define SECTION_VOLUME CHUNK_SIZE
+
+/// Bits per index once the palette is dropped and cubes are stored directly.
+#define SECTION_DIRECT_BITS 16
+
+/// Orders of the cubes within a section. Pick one at compile time by
+/// defining CHUNK_LAYOUT, see JEEFCRAFT_CHUNK_LAYOUT in CMakeLists.txt.
+///
+/// YMAJOR: y is contiguous, then z, then x. Vertical neighbours are adjacent
+///         and horizontal neighbours are a column or a whole slice apart.
+/// XZY:    x is contiguous, then z, then y. Each horizontal layer is
+///         contiguous which suits code that walks the world a layer at a
+///         time.
+/// MORTON: 3D Z-order curve with y in the lowest bit, then z, then x. All
+///         6 neighbours of a cube are usually within a few cache lines.
+#define CHUNK_LAYOUT_YMAJOR 0
+#define CHUNK_LAYOUT_XZY 1
+#define CHUNK_LAYOUT_MORTON 2
+
+#ifndef CHUNK_LAYOUT
+#define CHUNK_LAYOUT CHUNK_LAYOUT_YMAJOR
+#endif
+
+#if CHUNK_LAYOUT == CHUNK_LAYOUT_MORTON
+#define CHUNK_LAYOUT_NAME "morton"
+#if CHUNK_WIDTH != CHUNK_HEIGHT || (CHUNK_WIDTH & (CHUNK_WIDTH - 1)) != 0 || CHUNK_WIDTH > 1024
+#error The Morton layout requires cubic sections with a power of two width.
+#endif
+#elif CHUNK_LAYOUT == CHUNK_LAYOUT_XZY
+#define CHUNK_LAYOUT_NAME "xzy"
+#elif CHUNK_LAYOUT == CHUNK_LAYOUT_YMAJOR
+#define CHUNK_LAYOUT_NAME "ymajor"
+#else
+#error Unknown CHUNK_LAYOUT.
+#endif
+
+/// A CHUNK_WIDTH x CHUNK_HEIGHT x CHUNK_WIDTH block of cubes.
+///
+/// A section that is entirely one cube is stored as just that cube with no
+/// heap storage at all (bitsPerIndex is 0). This is the case for all of the
+/// sky and most of the underground.
+///
+/// Otherwise the section keeps a small palette of the distinct cubes it
+/// contains and a bit-packed array of indices into that palette. The index
+/// width starts at 1 bit and doubles (1, 2, 4, 8) whenever the palette runs
+/// out of room. Once more than 256 distinct cubes are present the palette is
+/// dropped and the packed cubes are stored directly at 16 bits each.
+///
+/// A zeroed out section is a valid section made entirely of air.
+typedef struct ChunkSection {
+   U16 *palette;     /// Packed cubes referenced by data. NULL when direct.
+   U64 *data;        /// Bit-packed palette indices, or packed cubes when direct.
+   U16 paletteCount; /// Number of palette entries in use.
+   U16 uniform;      /// The packed cube filling the section when bitsPerIndex is 0.
+   U16 solidCount;   /// Number of cubes that are not air.
+   U8 bitsPerIndex;  /// Width of each entry within data.
+} ChunkSection;
+
+/// Sets up the pools that section storage is allocated from. Must be called
+/// before any section stores more than one kind of cube.
+void initChunkSectionPools();
+
+/// Frees the section pools. Every section must have been freed first.
+void freeChunkSectionPools();
+
+/// Sums up the stats of every section storage pool. The high water mark is
+/// the sum of the high water marks of each pool.
+/// @param stats Output for the combined stats.
+void getChunkSectionPoolStats(PoolStats *stats);
+
+/// Initializes a section where every cube is set to fill. No storage is
+/// allocated until a different cube is written.
+/// @param section The section to initialize.
+/// @param fill The cube that every position will hold.
+void initChunkSection(ChunkSection *section, Cube fill);
+
+/// Frees all memory owned by the section and zeroes it out.
+/// @param section The section to free.
+void freeChunkSection(ChunkSection *section);
+
+/// Writes a cube into the section, growing the palette if required.
+/// @param section The section to write into.
+/// @param x The local x position [0, CHUNK_WIDTH).
+/// @param y The local y position [0, CHUNK_HEIGHT).
+/// @param z The local z position [0, CHUNK_WIDTH).
+/// @param cube The cube to store.
+void setSectionCube(ChunkSection *section, S32 x, S32 y, S32 z, Cube cube);
+
+/// Calculates the amount of heap memory the section is using.
+/// @param section The section to query.
+/// @return The number of bytes owned by the section.
+WordSize getChunkSectionMemoryUsage(const ChunkSection *section);
+
+#if CHUNK_LAYOUT == CHUNK_LAYOUT_MORTON
+/// Spreads the low 10 bits of v out so that there are two zero bits between
+/// each of them.
+static inline U32 spreadSectionIndexBits(U32 v) {
+   v = (v | (v << 16)) & 0x030000FFU;
+   v = (v | (v << 8)) & 0x0300F00FU;
+   v = (v | (v << 4)) & 0x030C30C3U;
+   v = (v | (v << 2)) & 0x09249249U;
+   return v;
+}
+#endif
+
+static inline S32 getSectionIndex(S32 x, S32 y, S32 z) {
+   assert(x >= 0 && x < CHUNK_WIDTH);
+   assert(y >= 0 && y < CHUNK_HEIGHT);
+   assert(z >= 0 && z < CHUNK_WIDTH);
+#if CHUNK_LAYOUT == CHUNK_LAYOUT_MORTON
+   return (S32)(spreadSectionIndexBits((U32)y) | (spreadSectionIndexBits((U32)z) << 1) | (spreadSectionIndexBits((U32)x) << 2));
+#elif CHUNK_LAYOUT == CHUNK_LAYOUT_XZY
+   return (y * CHUNK_WIDTH + z) * CHUNK_WIDTH + x;
+#else
+   return (x * CHUNK_WIDTH + z) * CHUNK_HEIGHT + y;
+#endif
+}
+
+/// log2 of an index width. Only powers of two are used so that an entry
+/// never straddles two words.
+static inline U32 getIndexWidthShift(U32 bitsPerIndex) {
+   switch (bitsPerIndex) {
+      case 1: return 0;
+      case 2: return 1;
+      case 4: return 2;
+      case 8: return 3;
+   }
+   return 4;
+}
+
+static inline U32 getSectionIndexShift(const ChunkSection *section) {
+   return getIndexWidthShift(section->bitsPerIndex);
+}
+
+static inline U32 getSectionEntry(const ChunkSection *section, S32 index) {
+   U32 shift = getSectionIndexShift(section);
+   U32 entriesPerWordShift = 6 - shift;
+   U64 word = section->data[index >> entriesPerWordShift];
+   U32 bitOffset = (U32)(index & ((1 << entriesPerWordShift) - 1)) << shift;
+   return (U32)(word >> bitOffset) & ((1U << section->bitsPerIndex) - 1U);
+}
+
+static inline Cube getSectionCube(const ChunkSection *section, S32 x, S32 y, S32 z) {
+   if (section->bitsPerIndex == 0)
+      return unpackCube(section->uniform);
+
+   U32 entry = getSectionEntry(section, getSectionIndex(x, y, z));
+   if (section->palette == NULL)
+      return unpackCube((U16)entry);
+   return unpackCube(section->palette[entry]);
+}
+
+static inline S32 getSectionAirCount(const ChunkSection *section) {
+   return SECTION_VOLUME - section->solidCount;
+}
+
+/// @return true if every cube in the section is air.
+static inline bool isSectionEmpty(const ChunkSection *section) {
+   return section->solidCount == 0;
+}
+
+/// @return true if no cube in the section is air.
+static inline bool isSectionFull(const ChunkSection *section) {
+   return section->solidCount == SECTION_VOLUME;
+}
+
+#endif
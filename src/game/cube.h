@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _GAME_CUBE_H_
+#define _GAME_CUBE_H_
+
+#include "base/types.h"
+
+/// Dimensions of a chunk in cubes. Every size in the game is derived from
+/// these two, so they can be changed at compile time to trade draw calls
+/// against remeshing cost. See JEEFCRAFT_CHUNK_WIDTH and
+/// JEEFCRAFT_CHUNK_HEIGHT in CMakeLists.txt.
+#ifndef CHUNK_WIDTH
+#define CHUNK_WIDTH 16
+#endif
+
+#ifndef CHUNK_HEIGHT
+#define CHUNK_HEIGHT 16
+#endif
+
+#define CHUNK_SIZE (S32)(CHUNK_HEIGHT * CHUNK_WIDTH * CHUNK_WIDTH)
+
+// The heightmap stores local y in an S8 and a section counts its solid cubes
+// in a U16.
+#if CHUNK_HEIGHT > 128 || CHUNK_HEIGHT * CHUNK_WIDTH * CHUNK_WIDTH > 65535
+#error Chunks can be at most 128 cubes tall and 65535 cubes in total.
+#endif
+
+typedef struct Cube {
+   U16 material : 10; // 1024 material types
+   U16 light : 4;     // 0-15 light level
+   U16 flag1 : 1;     // 1-bit extra flag
+   U16 flag2 : 1;     // 1-bit extra flag
+} Cube;
+
+typedef enum Materials {
+   Material_Air,
+   Material_Bedrock,
+   Material_Dirt,
+   Material_Grass,      // Also note that bottoms of grass have dirt blocks.
+   Material_Grass_Side, // Sides of grass have a special texture.
+   Material_Wood_Trunk,
+   Material_Leaves
+} Material;
+
+/// Packs a cube into a plain 16-bit value so that it can be compared
+/// and stored without relying on the compiler's bitfield layout.
+static inline U16 packCube(Cube cube) {
+   return (U16)(cube.material | (cube.light << 10) | (cube.flag1 << 14) | (cube.flag2 << 15));
+}
+
+static inline Cube unpackCube(U16 bits) {
+   Cube cube;
+   cube.material = bits & 0x3FF;
+   cube.light = (bits >> 10) & 0xF;
+   cube.flag1 = (bits >> 14) & 0x1;
+   cube.flag2 = (bits >> 15) & 0x1;
+   return cube;
+}
+
+static inline Cube createCube(Material material) {
+   return unpackCube((U16)material);
+}
+
+#endif
@@ -0,0 +1,256 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <GL/glew.h>
+#include "game/horizon.h"
+#include "game/chunk.h"
+#include "game/worldGen.h"
+#include "graphics/shader.h"
+
+#define HORIZON_TILE_CELLS (HORIZON_TILE_WIDTH / HORIZON_TILE_STEP)
+#define HORIZON_TILE_VERTICES ((HORIZON_TILE_CELLS + 1) * (HORIZON_TILE_CELLS + 1))
+#define HORIZON_TILE_INDICES (HORIZON_TILE_CELLS * HORIZON_TILE_CELLS * 6)
+
+// Heights are sampled one step past every edge of a tile so that the
+// normals along the edge match the next tile's.
+#define HORIZON_SAMPLE_WIDTH (HORIZON_TILE_CELLS + 3)
+
+/// The most tiles built in one frame. Each is a few hundred calls to
+/// getTerrainHeight.
+#define HORIZON_TILES_PER_FRAME 2
+
+/// A corner of a heightfield tile. Unlike a chunk's GPUVertex the heights
+/// can be anywhere, so the position is kept in floats.
+typedef struct HorizonVertex {
+   Vec3 position; /// Position within the tile.
+   F32 normalX;   /// x and z of the normal, which always points up.
+   F32 normalZ;
+} HorizonVertex;
+
+typedef struct HorizonTile {
+   S32 x;         /// Tile coordinates.
+   S32 z;
+   F32 minHeight; /// Lowest and highest vertex, for culling.
+   F32 maxHeight;
+   U32 vbo;       /// OpenGL Vertex Buffer Object. Every tile shares the same indices.
+} HorizonTile;
+
+typedef struct Horizon {
+   HashMap tiles;      /// Built tiles, keyed by getChunkColumnKey of their coordinates.
+   S32 centerX;        /// The tile the camera was in at the last update.
+   S32 centerZ;
+   bool complete;      /// Every tile in range of the center is built.
+   U32 ibo;            /// OpenGL Index Buffer Object shared by every tile.
+   U32 program;
+   S32 projMatrixLoc;
+   S32 modelMatrixLoc;
+   S32 voxelBoundsLoc;
+   S32 voxelHeightsLoc;
+} Horizon;
+
+static Horizon gHorizon;
+
+void initHorizon() {
+   generateShaderProgram("Shaders/horizon.vert", "Shaders/horizon.frag", &gHorizon.program);
+   gHorizon.projMatrixLoc = glGetUniformLocation(gHorizon.program, "projViewMatrix");
+   gHorizon.modelMatrixLoc = glGetUniformLocation(gHorizon.program, "modelMatrix");
+   gHorizon.voxelBoundsLoc = glGetUniformLocation(gHorizon.program, "voxelBounds");
+   gHorizon.voxelHeightsLoc = glGetUniformLocation(gHorizon.program, "voxelHeights");
+
+   initHashMap(&gHorizon.tiles, (HORIZON_RADIUS * 2 + 3) * (HORIZON_RADIUS * 2 + 3));
+   gHorizon.centerX = 0;
+   gHorizon.centerZ = 0;
+   gHorizon.complete = false;
+
+   // Every tile is the same grid, so they can all use the same indices.
+   GPUIndex indices[HORIZON_TILE_INDICES];
+   S32 in = 0;
+   for (S32 x = 0; x < HORIZON_TILE_CELLS; ++x) {
+      for (S32 z = 0; z < HORIZON_TILE_CELLS; ++z) {
+         GPUIndex corner = (GPUIndex)(x * (HORIZON_TILE_CELLS + 1) + z);
+         indices[in] = corner;
+         indices[in + 1] = corner + 1;
+         indices[in + 2] = corner + HORIZON_TILE_CELLS + 1;
+         indices[in + 3] = corner + HORIZON_TILE_CELLS + 1;
+         indices[in + 4] = corner + 1;
+         indices[in + 5] = corner + HORIZON_TILE_CELLS + 2;
+         in += 6;
+      }
+   }
+   glGenBuffers(1, &gHorizon.ibo);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gHorizon.ibo);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GPUIndex) * HORIZON_TILE_INDICES, indices, GL_STATIC_DRAW);
+}
+
+static void freeHorizonTile(HorizonTile *tile) {
+   glDeleteBuffers(1, &tile->vbo);
+   free(tile);
+}
+
+void freeHorizon() {
+   U32 iterator = 0;
+   HorizonTile *tile;
+   while ((tile = (HorizonTile*)hashMapNext(&gHorizon.tiles, &iterator, NULL)) != NULL)
+      freeHorizonTile(tile);
+   freeHashMap(&gHorizon.tiles);
+   glDeleteBuffers(1, &gHorizon.ibo);
+}
+
+F32 getHorizonDistance() {
+   return (F32)(HORIZON_RADIUS * HORIZON_TILE_WIDTH);
+}
+
+// Samples the terrain height under every vertex of a tile and one step
+// around it for the normals, and uploads the vertices.
+static HorizonTile* buildHorizonTile(S32 tileX, S32 tileZ) {
+   S32 worldX = tileX * HORIZON_TILE_WIDTH;
+   S32 worldZ = tileZ * HORIZON_TILE_WIDTH;
+
+   // The top of the surface cube, one above its height.
+   F32 heights[HORIZON_SAMPLE_WIDTH][HORIZON_SAMPLE_WIDTH];
+   for (S32 x = 0; x < HORIZON_SAMPLE_WIDTH; ++x) {
+      for (S32 z = 0; z < HORIZON_SAMPLE_WIDTH; ++z)
+         heights[x][z] = (F32)(getTerrainHeight(worldX + (x - 1) * HORIZON_TILE_STEP, worldZ + (z - 1) * HORIZON_TILE_STEP) + 1);
+   }
+
+   HorizonTile *tile = (HorizonTile*)malloc(sizeof(HorizonTile));
+   tile->x = tileX;
+   tile->z = tileZ;
+   tile->minHeight = heights[1][1];
+   tile->maxHeight = heights[1][1];
+
+   HorizonVertex vertices[HORIZON_TILE_VERTICES];
+   for (S32 x = 0; x <= HORIZON_TILE_CELLS; ++x) {
+      for (S32 z = 0; z <= HORIZON_TILE_CELLS; ++z) {
+         F32 height = heights[x + 1][z + 1];
+         F32 slopeX = (heights[x + 2][z + 1] - heights[x][z + 1]) / (2.0f * HORIZON_TILE_STEP);
+         F32 slopeZ = (heights[x + 1][z + 2] - heights[x + 1][z]) / (2.0f * HORIZON_TILE_STEP);
+         F32 length = sqrtf(slopeX * slopeX + slopeZ * slopeZ + 1.0f);
+
+         HorizonVertex *vertex = &vertices[x * (HORIZON_TILE_CELLS + 1) + z];
+         vertex->position = create_vec3((F32)(x * HORIZON_TILE_STEP), height, (F32)(z * HORIZON_TILE_STEP));
+         vertex->normalX = -slopeX / length;
+         vertex->normalZ = -slopeZ / length;
+
+         if (height < tile->minHeight)
+            tile->minHeight = height;
+         if (height > tile->maxHeight)
+            tile->maxHeight = height;
+      }
+   }
+
+   glGenBuffers(1, &tile->vbo);
+   glBindBuffer(GL_ARRAY_BUFFER, tile->vbo);
+   glBufferData(GL_ARRAY_BUFFER, sizeof(HorizonVertex) * HORIZON_TILE_VERTICES, vertices, GL_STATIC_DRAW);
+   return tile;
+}
+
+// Frees the tiles that are more than a tile out of range. The extra tile
+// keeps the camera from rebuilding tiles as it goes back and forth over a
+// tile border.
+static void evictHorizonTiles() {
+   U64 *evicted = (U64*)malloc(sizeof(U64) * (gHorizon.tiles.count + 1));
+   U32 evictedCount = 0;
+   U32 iterator = 0;
+   U64 key;
+   HorizonTile *tile;
+   while ((tile = (HorizonTile*)hashMapNext(&gHorizon.tiles, &iterator, &key)) != NULL) {
+      if (abs(tile->x - gHorizon.centerX) > HORIZON_RADIUS + 1 || abs(tile->z - gHorizon.centerZ) > HORIZON_RADIUS + 1)
+         evicted[evictedCount++] = key;
+   }
+
+   for (U32 i = 0; i < evictedCount; ++i)
+      freeHorizonTile((HorizonTile*)hashMapRemove(&gHorizon.tiles, evicted[i]));
+   free(evicted);
+}
+
+void updateHorizon(Vec3 cameraPos) {
+   S32 centerX = getChunkCoordinate((S32)floorf(cameraPos.x), HORIZON_TILE_WIDTH);
+   S32 centerZ = getChunkCoordinate((S32)floorf(cameraPos.z), HORIZON_TILE_WIDTH);
+   if (centerX != gHorizon.centerX || centerZ != gHorizon.centerZ) {
+      gHorizon.centerX = centerX;
+      gHorizon.centerZ = centerZ;
+      gHorizon.complete = false;
+      evictHorizonTiles();
+   }
+   if (gHorizon.complete)
+      return;
+
+   // Walk outwards one ring of tiles at a time.
+   S32 builtCount = 0;
+   for (S32 ring = 0; ring <= HORIZON_RADIUS; ++ring) {
+      for (S32 x = -ring; x <= ring; ++x) {
+         // Only the first and last row of the ring are full.
+         S32 stepZ = (x == -ring || x == ring) ? 1 : ring * 2;
+         for (S32 z = -ring; z <= ring; z += stepZ) {
+            U64 key = getChunkColumnKey(centerX + x, centerZ + z);
+            if (hashMapGet(&gHorizon.tiles, key) != NULL)
+               continue;
+            if (builtCount == HORIZON_TILES_PER_FRAME)
+               return;
+
+            hashMapInsert(&gHorizon.tiles, key, buildHorizonTile(centerX + x, centerZ + z));
+            builtCount++;
+         }
+      }
+   }
+   gHorizon.complete = true;
+}
+
+void renderHorizon(mat4 projView, Frustum *frustum, Vec4 voxelBounds, F32 voxelMinY, F32 voxelMaxY) {
+   glUseProgram(gHorizon.program);
+   glUniformMatrix4fv(gHorizon.projMatrixLoc, 1, GL_FALSE, &(projView[0][0]));
+   glUniform4f(gHorizon.voxelBoundsLoc, voxelBounds.x, voxelBounds.y, voxelBounds.z, voxelBounds.w);
+   glUniform2f(gHorizon.voxelHeightsLoc, voxelMinY, voxelMaxY);
+
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gHorizon.ibo);
+   glEnableVertexAttribArray(0);
+   glEnableVertexAttribArray(1);
+
+   U32 iterator = 0;
+   HorizonTile *tile;
+   while ((tile = (HorizonTile*)hashMapNext(&gHorizon.tiles, &iterator, NULL)) != NULL) {
+      Vec3 pos = create_vec3((F32)(tile->x * HORIZON_TILE_WIDTH), 0.0f, (F32)(tile->z * HORIZON_TILE_WIDTH));
+
+      // Tiles that are entirely covered by loaded chunks are never seen. The
+      // heights are the tops of the surface cubes, so a tile is covered if
+      // every one of them is above the bottom layer and at most the top.
+      if (pos.x >= voxelBounds.x && pos.z >= voxelBounds.y && pos.x + HORIZON_TILE_WIDTH <= voxelBounds.z && pos.z + HORIZON_TILE_WIDTH <= voxelBounds.w &&
+          tile->minHeight > voxelMinY && tile->maxHeight <= voxelMaxY)
+         continue;
+
+      F32 halfHeight = (tile->maxHeight - tile->minHeight) / 2.0f;
+      Vec3 halfExtents = create_vec3(HORIZON_TILE_WIDTH / 2.0f, halfHeight, HORIZON_TILE_WIDTH / 2.0f);
+      Vec3 center = create_vec3(pos.x + halfExtents.x, tile->minHeight + halfHeight, pos.z + halfExtents.z);
+      if (!FrustumCullBox(frustum, center, halfExtents))
+         continue;
+
+      mat4 modelMatrix;
+      glm_mat4_identity(modelMatrix);
+      glm_translate(modelMatrix, pos.vec);
+      glUniformMatrix4fv(gHorizon.modelMatrixLoc, 1, GL_FALSE, &(modelMatrix[0][0]));
+      glBindBuffer(GL_ARRAY_BUFFER, tile->vbo);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(HorizonVertex), (void*)offsetof(HorizonVertex, position));
+      glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HorizonVertex), (void*)offsetof(HorizonVertex, normalX));
+      glDrawElements(GL_TRIANGLES, (GLsizei)HORIZON_TILE_INDICES, GL_UNSIGNED_SHORT, (void*)0);
+   }
+
+   glDisableVertexAttribArray(0);
+   glDisableVertexAttribArray(1);
+}
@@ -0,0 +1,68 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _GAME_HORIZON_H_
+#define _GAME_HORIZON_H_
+
+#include "math/frustum.h"
+
+/// Far-field terrain drawn past the loaded chunks.
+///
+/// The horizon is a grid of HORIZON_TILE_WIDTH wide tiles built straight
+/// from getTerrainHeight, a sample every HORIZON_TILE_STEP cubes. No cubes
+/// are generated or meshed for it, so it reaches HORIZON_RADIUS tiles out
+/// for a few megabytes of vertex data. Caves and trees don't show up in it.
+///
+/// Tiles are cached by tile coordinate and only rebuilt once the camera
+/// has moved far enough for them to drop out of range. The loaded chunks
+/// are drawn instead of the horizon wherever they are.
+
+/// Width and depth of a tile in cubes.
+#define HORIZON_TILE_WIDTH 64
+
+/// Distance in cubes between the height samples of a tile.
+#define HORIZON_TILE_STEP 4
+
+/// Number of tiles the horizon reaches out from the camera's tile.
+#define HORIZON_RADIUS 8
+
+/// Loads the shader and the index buffer shared by every tile.
+void initHorizon();
+
+/// Frees every tile and the GL objects of the horizon.
+void freeHorizon();
+
+/// @return How far the horizon reaches from the camera, in cubes.
+F32 getHorizonDistance();
+
+/// Drops the tiles that went out of range and builds a few of the missing
+/// ones, nearest to the camera first. The rest are built over the next
+/// frames, so this never takes long.
+/// @param cameraPos The position of the camera.
+void updateHorizon(Vec3 cameraPos);
+
+/// Draws the horizon tiles. Nothing is drawn within the loaded chunks.
+/// Terrain above or below the loaded layers is still drawn, even within
+/// their x, z area.
+/// @param projView The projection * view matrix.
+/// @param frustum The frustum to cull tiles against.
+/// @param voxelBounds The x, z area of the loaded chunks in world space:
+///        min x, min z, max x and max z.
+/// @param voxelMinY The bottom of the loaded chunks in world space.
+/// @param voxelMaxY The top of the loaded chunks in world space.
+void renderHorizon(mat4 projView, Frustum *frustum, Vec4 voxelBounds, F32 voxelMinY, F32 voxelMaxY);
+
+#endif
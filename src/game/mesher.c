@@ -0,0 +1,520 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "game/mesher.h"
+#include "platform/thread.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Taken from std_voxel_render.h, from the public domain
+F32 cubes[6][4][4] = {
+   { { 1,0,1,0 },{ 1,1,1,0 },{ 1,1,0,0 },{ 1,0,0,0 } }, // east
+   { { 1,1,1,1 },{ 0,1,1,1 },{ 0,1,0,1 },{ 1,1,0,1 } }, // up
+   { { 0,1,1,2 },{ 0,0,1,2 },{ 0,0,0,2 },{ 0,1,0,2 } }, // west
+   { { 0,0,1,3 },{ 1,0,1,3 },{ 1,0,0,3 },{ 0,0,0,3 } }, // down
+   { { 0,1,1,4 },{ 1,1,1,4 },{ 1,0,1,4 },{ 0,0,1,4 } }, // north
+   { { 0,0,0,5 },{ 1,0,0,5 },{ 1,1,0,5 },{ 0,1,0,5 } }, // south
+};
+
+static F32 cubeUVs[6][4][2] = {
+   { { 0, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 } }, // East
+   { { 1, 1 }, { 0, 1 }, { 0, 0 }, { 1, 0 } }, // up
+   { { 1, 0 }, { 1, 1 }, { 0, 1 }, { 0, 0 } }, // west
+   { { 0, 1 }, { 1, 1 }, { 1, 0 }, { 0, 0 } }, // down
+   { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } }, // north
+   { { 1, 1 }, { 0, 1 }, { 0, 0 }, { 1, 0 } }  // south
+};
+
+/// The axis that u and v of cubeUVs run along on each side, so that a face
+/// covering several cubes repeats the texture once per cube.
+static const S32 cubeUVAxes[6][2] = {
+   { 2, 1 }, // East
+   { 0, 2 }, // up
+   { 2, 1 }, // west
+   { 0, 2 }, // down
+   { 0, 1 }, // north
+   { 0, 1 }  // south
+};
+
+/// The texture atlas is this many tiles wide and high.
+#define TEXTURE_ATLAS_COUNT 32
+
+static bool gGreedyMeshing = GREEDY_MESHING;
+
+/// The most scratch buffers kept around for reuse. Anything past this goes
+/// back to the heap when a whole batch of chunks is uploaded at once.
+#define MESH_SCRATCH_MAX_FREE 16
+
+/// The smallest scratch buffer allocated, in vertices. Buffers grow in
+/// powers of two from here so that they soon fit any mesh.
+#define MESH_SCRATCH_MIN_VERTICES 4096
+
+typedef struct MeshScratch {
+   GPUVertex *vertices;
+   S32 capacity;        /// Number of vertices there is room for.
+} MeshScratch;
+
+/// Vertex buffers of render chunks that were already uploaded. They keep
+/// their capacity so meshing the next render chunk doesn't need the heap.
+static MeshScratch gFreeMeshScratch[MESH_SCRATCH_MAX_FREE];
+static S32 gFreeMeshBufferCount = 0;
+
+/// An allocation is only counted as reused if the buffer was big enough.
+static PoolStats gMeshScratchStats;
+
+/// Chunks are meshed on several threads at once. Guards the free buffers and
+/// the stats.
+static Mutex *gMeshScratchMutex = NULL;
+
+// Hands a render chunk a buffer with room for at least vertexCount
+// vertices. Faces are then written straight into it.
+static void acquireMeshScratch(RenderChunk *renderChunk, S32 vertexCount) {
+   MeshScratch scratch;
+   scratch.vertices = NULL;
+   scratch.capacity = 0;
+
+   lockMutex(gMeshScratchMutex);
+   if (gFreeMeshBufferCount > 0) {
+      // Take the first buffer that fits, or else the biggest to grow it.
+      S32 pick = 0;
+      for (S32 i = 0; i < gFreeMeshBufferCount; ++i) {
+         if (gFreeMeshScratch[i].capacity >= vertexCount) {
+            pick = i;
+            break;
+         }
+         if (gFreeMeshScratch[i].capacity > gFreeMeshScratch[pick].capacity)
+            pick = i;
+      }
+      scratch = gFreeMeshScratch[pick];
+      gFreeMeshScratch[pick] = gFreeMeshScratch[--gFreeMeshBufferCount];
+   }
+   bool reused = scratch.capacity >= vertexCount;
+   poolStatsAlloc(&gMeshScratchStats, reused);
+   unlockMutex(gMeshScratchMutex);
+
+   if (!reused) {
+      S32 capacity = scratch.capacity > MESH_SCRATCH_MIN_VERTICES ? scratch.capacity : MESH_SCRATCH_MIN_VERTICES;
+      while (capacity < vertexCount)
+         capacity *= 2;
+      free(scratch.vertices);
+      scratch.vertices = (GPUVertex*)malloc(sizeof(GPUVertex) * capacity);
+      scratch.capacity = capacity;
+   }
+
+   renderChunk->vertexData = scratch.vertices;
+   renderChunk->vertexCapacity = scratch.capacity;
+   renderChunk->vertexCount = 0;
+}
+
+void setGreedyMeshing(bool enabled) {
+   gGreedyMeshing = enabled;
+}
+
+bool isGreedyMeshing() {
+   return gGreedyMeshing;
+}
+
+// Builds a face covering size[0] x size[1] x size[2] cubes from position.
+// The size along the side's own axis is 1. generateGeometry has already
+// made room for every face.
+static void buildQuad(Chunk *chunk, S32 side, S32 material, const S32 position[3], const S32 size[3]) {
+   RenderChunk *renderChunk = &chunk->renderChunk;
+   assert(renderChunk->vertexCount + QUAD_VERTEX_COUNT <= renderChunk->vertexCapacity);
+
+   GPUVertex *vertices = &renderChunk->vertexData[renderChunk->vertexCount];
+   for (S32 i = 0; i < QUAD_VERTEX_COUNT; ++i) {
+      GPUVertex *v = &vertices[i];
+      v->x = (U8)((S32)cubes[side][i][0] * size[0] + position[0]);
+      v->y = (U8)((S32)cubes[side][i][1] * size[1] + position[1]);
+      v->z = (U8)((S32)cubes[side][i][2] * size[2] + position[2]);
+      v->side = (U8)side;
+      v->u = (U8)((S32)cubeUVs[side][i][0] * size[cubeUVAxes[side][0]]);
+      v->v = (U8)((S32)cubeUVs[side][i][1] * size[cubeUVAxes[side][1]]);
+      v->tileX = (U8)(material % TEXTURE_ATLAS_COUNT);
+      v->tileY = (U8)(material / TEXTURE_ATLAS_COUNT);
+   }
+   renderChunk->vertexCount += QUAD_VERTEX_COUNT;
+}
+
+static void buildFace(Chunk *chunk, S32 side, S32 material, S32 x, S32 y, S32 z) {
+   static const S32 size[3] = { 1, 1, 1 };
+   S32 position[3] = { x, y, z };
+   buildQuad(chunk, side, material, position, size);
+}
+
+void fillQuadIndices(GPUIndex *indices, S32 quadCount) {
+   for (S32 i = 0; i < quadCount; ++i) {
+      GPUIndex in = (GPUIndex)(i * QUAD_VERTEX_COUNT);
+      GPUIndex *quad = &indices[i * QUAD_INDEX_COUNT];
+      quad[0] = in;
+      quad[1] = in + 2;
+      quad[2] = in + 1;
+      quad[3] = in;
+      quad[4] = in + 3;
+      quad[5] = in + 2;
+   }
+}
+
+// A solid chunk only needs faces if one of its neighbours has air in it.
+// Faces at the edge of the loaded world are always built.
+static bool isChunkEnclosed(Chunk *chunk) {
+   if (!isSectionFull(&chunk->section))
+      return false;
+
+   for (S32 i = 0; i < ChunkNeighbour_Count; ++i) {
+      Chunk *neighbour = chunk->neighbours[i];
+      if (neighbour == NULL || !isSectionFull(&neighbour->section))
+         return false;
+   }
+   return true;
+}
+
+#if CHUNK_HEIGHT > 62
+#error The mesher packs a column of cubes and the cube above and below it into 64 bits.
+#endif
+
+/// Width of a chunk with a layer of its neighbours' cubes on either side.
+#define PADDED_WIDTH (CHUNK_WIDTH + 2)
+
+/// The bits of a column that belong to the chunk itself.
+#define COLUMN_MASK ((((U64)1) << CHUNK_HEIGHT) - 1)
+
+/// The largest slice of a chunk, across any axis.
+#define MESH_MASK_SIZE (CHUNK_WIDTH * (CHUNK_WIDTH > CHUNK_HEIGHT ? CHUNK_WIDTH : CHUNK_HEIGHT))
+
+/// The axis each side faces along, indexed by CubeSides.
+static const S32 cubeSideAxes[6] = { 0, 1, 0, 1, 2, 2 };
+
+/// A chunk copied out for meshing. Whether a cube is solid is kept as a bit
+/// per cube, a column of cubes along y to a U64, so the visible faces of a
+/// whole column are found with a few shifts and ANDs.
+typedef struct MeshVolume {
+   U16 materials[CHUNK_SIZE];                 /// Materials of the chunk's cubes, see getMeshColumnIndex.
+   U64 solid[PADDED_WIDTH * PADDED_WIDTH];    /// Solid cubes of the chunk and the layer of neighbours around it, bit y + 1 for the cube at y. See getPaddedColumnIndex.
+   U64 faces[6][CHUNK_WIDTH * CHUNK_WIDTH];   /// Visible faces of each side, bit y for the cube at y. Indexed by CubeSides, then getMeshColumnIndex.
+} MeshVolume;
+
+static inline S32 getMeshColumnIndex(S32 x, S32 z) {
+   return x * CHUNK_WIDTH + z;
+}
+
+static inline S32 getPaddedColumnIndex(S32 x, S32 z) {
+   return (x + 1) * PADDED_WIDTH + (z + 1);
+}
+
+static inline S32 countTrailingZeros(U64 bits) {
+#ifdef _MSC_VER
+   unsigned long index;
+   if (_BitScanForward(&index, (unsigned long)bits))
+      return (S32)index;
+   _BitScanForward(&index, (unsigned long)(bits >> 32));
+   return (S32)index + 32;
+#else
+   return __builtin_ctzll(bits);
+#endif
+}
+
+static inline S32 countBits(U64 bits) {
+#ifdef _MSC_VER
+   bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+   bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+   bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+   return (S32)((bits * 0x0101010101010101ULL) >> 56);
+#else
+   return __builtin_popcountll(bits);
+#endif
+}
+
+// The solid cubes of a column of a neighbouring chunk, shifted to line up
+// with the padded columns.
+static U64 getSolidColumn(Chunk *chunk, S32 x, S32 z) {
+   U64 column = 0;
+   for (S32 y = 0; y < CHUNK_HEIGHT; ++y) {
+      if (!isTransparent(chunk, x, y, z))
+         column |= ((U64)1) << (y + 1);
+   }
+   return column;
+}
+
+// The material a side of a cube is drawn with. Grass has dirt under it and
+// a texture of its own on the sides.
+static inline S32 getFaceMaterial(S32 material, S32 side) {
+   if (material != Material_Grass || side == CubeSides_Up)
+      return material;
+   return side == CubeSides_Down ? Material_Dirt : Material_Grass_Side;
+}
+
+// Copies the cubes of a chunk and whether the cubes around it that its faces
+// can touch are solid. Past the edge of the loaded world is air so that the
+// faces there are built.
+static void fillMeshVolume(Chunk *chunk, MeshVolume *volume) {
+   memset(volume->solid, 0, sizeof(volume->solid));
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+         U16 *materials = &volume->materials[getMeshColumnIndex(x, z) * CHUNK_HEIGHT];
+         U64 column = 0;
+         for (S32 y = 0; y < CHUNK_HEIGHT; ++y) {
+            materials[y] = (U16)getCubeAt(chunk, x, y, z).material;
+            if (materials[y] != Material_Air)
+               column |= ((U64)1) << (y + 1);
+         }
+         volume->solid[getPaddedColumnIndex(x, z)] = column;
+      }
+   }
+
+   // The chunks above and below fill in the ends of each column.
+   Chunk *chunkNegativeY = chunk->neighbours[ChunkNeighbour_NegativeY];
+   Chunk *chunkPositiveY = chunk->neighbours[ChunkNeighbour_PositiveY];
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+         U64 *column = &volume->solid[getPaddedColumnIndex(x, z)];
+         if (chunkNegativeY != NULL && !isTransparent(chunkNegativeY, x, CHUNK_HEIGHT - 1, z))
+            *column |= 1;
+         if (chunkPositiveY != NULL && !isTransparent(chunkPositiveY, x, 0, z))
+            *column |= ((U64)1) << (CHUNK_HEIGHT + 1);
+      }
+   }
+
+   // The chunks beside it add whole columns.
+   Chunk *chunkNegativeX = chunk->neighbours[ChunkNeighbour_NegativeX];
+   Chunk *chunkPositiveX = chunk->neighbours[ChunkNeighbour_PositiveX];
+   Chunk *chunkNegativeZ = chunk->neighbours[ChunkNeighbour_NegativeZ];
+   Chunk *chunkPositiveZ = chunk->neighbours[ChunkNeighbour_PositiveZ];
+   for (S32 i = 0; i < CHUNK_WIDTH; ++i) {
+      if (chunkNegativeX != NULL)
+         volume->solid[getPaddedColumnIndex(-1, i)] = getSolidColumn(chunkNegativeX, CHUNK_WIDTH - 1, i);
+      if (chunkPositiveX != NULL)
+         volume->solid[getPaddedColumnIndex(CHUNK_WIDTH, i)] = getSolidColumn(chunkPositiveX, 0, i);
+      if (chunkNegativeZ != NULL)
+         volume->solid[getPaddedColumnIndex(i, -1)] = getSolidColumn(chunkNegativeZ, i, CHUNK_WIDTH - 1);
+      if (chunkPositiveZ != NULL)
+         volume->solid[getPaddedColumnIndex(i, CHUNK_WIDTH)] = getSolidColumn(chunkPositiveZ, i, 0);
+   }
+}
+
+// A face is visible where a solid cube has air on that side of it.
+static void findVisibleFaces(MeshVolume *volume) {
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+         S32 index = getMeshColumnIndex(x, z);
+         U64 column = volume->solid[getPaddedColumnIndex(x, z)];
+         volume->faces[CubeSides_Up][index] = ((column & ~(column >> 1)) >> 1) & COLUMN_MASK;
+         volume->faces[CubeSides_Down][index] = ((column & ~(column << 1)) >> 1) & COLUMN_MASK;
+         volume->faces[CubeSides_East][index] = ((column & ~volume->solid[getPaddedColumnIndex(x + 1, z)]) >> 1) & COLUMN_MASK;
+         volume->faces[CubeSides_West][index] = ((column & ~volume->solid[getPaddedColumnIndex(x - 1, z)]) >> 1) & COLUMN_MASK;
+         volume->faces[CubeSides_North][index] = ((column & ~volume->solid[getPaddedColumnIndex(x, z + 1)]) >> 1) & COLUMN_MASK;
+         volume->faces[CubeSides_South][index] = ((column & ~volume->solid[getPaddedColumnIndex(x, z - 1)]) >> 1) & COLUMN_MASK;
+      }
+   }
+}
+
+// The number of faces generateCubeGeometry builds. Greedy meshing only
+// merges faces, so it never builds more than this.
+static S32 countVisibleFaces(const MeshVolume *volume) {
+   S32 count = 0;
+   for (S32 side = 0; side < 6; ++side) {
+      for (S32 i = 0; i < CHUNK_WIDTH * CHUNK_WIDTH; ++i)
+         count += countBits(volume->faces[side][i]);
+   }
+   return count;
+}
+
+// Builds one face per visible side of every cube.
+static void generateCubeGeometry(Chunk *chunk, const MeshVolume *volume) {
+   // The order the faces of a cube have always been built in.
+   static const S32 sides[6] = {
+      CubeSides_Up,
+      CubeSides_Down,
+      CubeSides_West,
+      CubeSides_East,
+      CubeSides_South,
+      CubeSides_North
+   };
+
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+         S32 index = getMeshColumnIndex(x, z);
+         U64 visible = 0;
+         for (S32 i = 0; i < 6; ++i)
+            visible |= volume->faces[i][index];
+
+         // Only visit the cubes that have a visible face.
+         while (visible != 0) {
+            S32 y = countTrailingZeros(visible);
+            visible &= visible - 1;
+
+            U64 bit = ((U64)1) << y;
+            S32 material = volume->materials[index * CHUNK_HEIGHT + y];
+            for (S32 i = 0; i < 6; ++i) {
+               if (volume->faces[sides[i]][index] & bit)
+                  buildFace(chunk, sides[i], getFaceMaterial(material, sides[i]), x, y, z);
+            }
+         }
+      }
+   }
+}
+
+// Builds the faces of one side of every cube, merging neighbouring faces
+// with the same material into one quad. Each slice of the chunk along the
+// side's axis is done on its own: faces are grown along v first and the
+// run is then widened along u as far as it stays the same.
+static void generateGreedySide(Chunk *chunk, const MeshVolume *volume, S32 side) {
+   S32 dims[3] = { CHUNK_WIDTH, CHUNK_HEIGHT, CHUNK_WIDTH };
+   S32 axis = cubeSideAxes[side];
+   S32 uAxis = axis == 0 ? 2 : 0;
+   S32 vAxis = axis == 1 ? 2 : 1;
+   S32 sizeU = dims[uAxis];
+   S32 sizeV = dims[vAxis];
+   const U64 *faces = volume->faces[side];
+
+   // Material + 1 of each visible face in the slice, 0 where there is none.
+   U16 mask[MESH_MASK_SIZE];
+   for (S32 d = 0; d < dims[axis]; ++d) {
+      S32 position[3];
+      position[axis] = d;
+      bool empty = true;
+      for (S32 u = 0; u < sizeU; ++u) {
+         U16 *row = &mask[u * sizeV];
+         position[uAxis] = u;
+         if (vAxis == 1) {
+            // A row of the slice is a whole column.
+            S32 index = getMeshColumnIndex(position[0], position[2]);
+            U64 column = faces[index];
+            if (column == 0) {
+               memset(row, 0, sizeof(U16) * sizeV);
+               continue;
+            }
+            empty = false;
+            const U16 *materials = &volume->materials[index * CHUNK_HEIGHT];
+            for (S32 v = 0; v < sizeV; ++v)
+               row[v] = ((column >> v) & 1) ? (U16)(getFaceMaterial(materials[v], side) + 1) : 0;
+         } else {
+            // Every cube of the slice is in a different column, at y = d.
+            for (S32 v = 0; v < sizeV; ++v) {
+               S32 index = getMeshColumnIndex(u, v);
+               U16 face = 0;
+               if ((faces[index] >> d) & 1) {
+                  face = (U16)(getFaceMaterial(volume->materials[index * CHUNK_HEIGHT + d], side) + 1);
+                  empty = false;
+               }
+               row[v] = face;
+            }
+         }
+      }
+      if (empty)
+         continue;
+      for (S32 u = 0; u < sizeU; ++u) {
+         for (S32 v = 0; v < sizeV; ++v) {
+            U16 face = mask[u * sizeV + v];
+            if (face == 0)
+               continue;
+
+            S32 height = 1;
+            while (v + height < sizeV && mask[u * sizeV + v + height] == face)
+               height++;
+
+            S32 width = 1;
+            for (; u + width < sizeU; ++width) {
+               const U16 *row = &mask[(u + width) * sizeV + v];
+               S32 i = 0;
+               while (i < height && row[i] == face)
+                  i++;
+               if (i < height)
+                  break;
+            }
+
+            for (S32 i = 0; i < width; ++i)
+               memset(&mask[(u + i) * sizeV + v], 0, sizeof(U16) * height);
+
+            S32 size[3];
+            size[axis] = 1;
+            size[uAxis] = width;
+            size[vAxis] = height;
+            position[uAxis] = u;
+            position[vAxis] = v;
+            buildQuad(chunk, side, face - 1, position, size);
+         }
+      }
+   }
+}
+
+void generateGeometry(Chunk *chunk) {
+   // Throw away a mesh that was built before but never uploaded.
+   freeRenderChunkGeometry(&chunk->renderChunk);
+   memset(&chunk->renderChunk, 0, sizeof(RenderChunk));
+
+   // Skip the 4096 cube walk when we already know there is nothing to build.
+   if (isSectionEmpty(&chunk->section) || isChunkEnclosed(chunk))
+      return;
+
+   MeshVolume volume;
+   fillMeshVolume(chunk, &volume);
+   findVisibleFaces(&volume);
+
+   // Count first so the vertices can be written without growing the buffer.
+   S32 faceCount = countVisibleFaces(&volume);
+   if (faceCount == 0)
+      return;
+   acquireMeshScratch(&chunk->renderChunk, faceCount * QUAD_VERTEX_COUNT);
+
+   if (gGreedyMeshing) {
+      // Build the faces of every cube, merging neighbouring faces that share
+      // a side and a material.
+      for (S32 side = 0; side < 6; ++side)
+         generateGreedySide(chunk, &volume, side);
+   } else {
+      generateCubeGeometry(chunk, &volume);
+   }
+}
+
+void freeRenderChunkGeometry(RenderChunk *renderChunk) {
+   if (renderChunk->vertexData == NULL)
+      return;
+
+   lockMutex(gMeshScratchMutex);
+   gMeshScratchStats.liveCount--;
+   bool keep = gFreeMeshBufferCount < MESH_SCRATCH_MAX_FREE;
+   if (keep) {
+      gFreeMeshScratch[gFreeMeshBufferCount].vertices = renderChunk->vertexData;
+      gFreeMeshScratch[gFreeMeshBufferCount].capacity = renderChunk->vertexCapacity;
+      gFreeMeshBufferCount++;
+   }
+   unlockMutex(gMeshScratchMutex);
+
+   if (!keep)
+      free(renderChunk->vertexData);
+   renderChunk->vertexData = NULL;
+}
+
+void initMeshScratch() {
+   gMeshScratchMutex = createMutex();
+}
+
+void freeMeshScratch() {
+   for (S32 i = 0; i < gFreeMeshBufferCount; ++i)
+      free(gFreeMeshScratch[i].vertices);
+   gFreeMeshBufferCount = 0;
+   freeMutex(gMeshScratchMutex);
+   gMeshScratchMutex = NULL;
+}
+
+const PoolStats* getMeshScratchStats() {
+   return &gMeshScratchStats;
+}
@@ -0,0 +1,83 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _GAME_MESHER_H_
+#define _GAME_MESHER_H_
+
+#include "base/pool.h"
+#include "game/chunk.h"
+
+/// Set to 0 to build one face per exposed cube side by default instead of
+/// merging faces with the same material into larger quads.
+#ifndef GREEDY_MESHING
+#define GREEDY_MESHING 1
+#endif
+
+typedef enum CubeSides {
+   CubeSides_East,
+   CubeSides_Up,
+   CubeSides_West,
+   CubeSides_Down,
+   CubeSides_North,
+   CubeSides_South,
+} CubeSides;
+
+/// Corner positions of each face of a unit cube, indexed by CubeSides. The
+/// w component holds the side.
+extern F32 cubes[6][4][4];
+
+/// Writes the indices that draw quads of QUAD_VERTEX_COUNT vertices each as
+/// 2 triangles. Every mesh uses the same indices.
+/// @param indices Filled with quadCount * QUAD_INDEX_COUNT indices.
+/// @param quadCount The number of quads, at most QUAD_INDEX_MAX_QUADS.
+void fillQuadIndices(GPUIndex *indices, S32 quadCount);
+
+/// Builds the vertex data of a chunk into its render chunk. The faces are
+/// counted first and written into a scratch buffer big enough for all of
+/// them, which is reused once the mesh is uploaded. Neighbouring chunks are
+/// read to cull faces at the seams. A mesh from an earlier call that was
+/// never uploaded is thrown away.
+/// @param chunk The chunk to build.
+void generateGeometry(Chunk *chunk);
+
+/// Picks how generateGeometry builds faces. Greedy meshing merges the faces
+/// of neighbouring cubes that share a side and a material into one quad,
+/// which draws the same surface with far fewer vertices. Only change it
+/// while no chunk is being meshed.
+/// @param enabled true to merge faces, false for one face per cube side.
+void setGreedyMeshing(bool enabled);
+
+/// @return true if faces are merged, see setGreedyMeshing.
+bool isGreedyMeshing();
+
+/// Releases the CPU side vertex data of a render chunk. The
+/// buffers are kept around and handed to the next render chunk that is
+/// meshed.
+/// @param renderChunk The render chunk to free the geometry of.
+void freeRenderChunkGeometry(RenderChunk *renderChunk);
+
+/// Sets up the buffers kept around for reuse. Must be called before any
+/// chunk is meshed.
+void initMeshScratch();
+
+/// Frees the buffers kept around for reuse.
+void freeMeshScratch();
+
+/// @return Stats on how often meshing reused a scratch buffer. Every
+///         allocation that wasn't reused went to the heap.
+const PoolStats* getMeshScratchStats();
+
+#endif
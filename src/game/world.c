@@ -15,13 +15,19 @@
 //----------------------------------------------------------------------------
 
 #include <math.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include <GL/glew.h>
-#include <stretchy_buffer.h>
-#include <open-simplex-noise.h>
 #include "game/world.h"
+#include "game/blockCursor.h"
 #include "game/camera.h"
+#include "game/chunk.h"
+#include "game/chunkPipeline.h"
+#include "game/horizon.h"
+#include "game/mesher.h"
+#include "game/worldFile.h"
+#include "game/worldGen.h"
 #include "graphics/shader.h"
 #include "graphics/texture2d.h"
 #include "math/frustum.h"
@@ -30,106 +36,57 @@
 #include "math/aabb.h"
 #include "platform/input.h"
 
-#define CHUNK_WIDTH 16
-#define MAX_CHUNK_HEIGHT 256
-#define RENDER_CHUNK_HEIGHT 16
-#define CHUNK_SIZE (S32)(MAX_CHUNK_HEIGHT * CHUNK_WIDTH * CHUNK_WIDTH)
-#define CHUNK_SPLITS (S32)(MAX_CHUNK_HEIGHT / RENDER_CHUNK_HEIGHT)
-
-// Taken from std_voxel_render.h, from the public domain
-static F32 cubes[6][4][4] = {
-   { { 1,0,1,0 },{ 1,1,1,0 },{ 1,1,0,0 },{ 1,0,0,0 } }, // east
-   { { 1,1,1,1 },{ 0,1,1,1 },{ 0,1,0,1 },{ 1,1,0,1 } }, // up
-   { { 0,1,1,2 },{ 0,0,1,2 },{ 0,0,0,2 },{ 0,1,0,2 } }, // west
-   { { 0,0,1,3 },{ 1,0,1,3 },{ 1,0,0,3 },{ 0,0,0,3 } }, // down
-   { { 0,1,1,4 },{ 1,1,1,4 },{ 1,0,1,4 },{ 0,0,1,4 } }, // north
-   { { 0,0,0,5 },{ 1,0,0,5 },{ 1,1,0,5 },{ 0,1,0,5 } }, // south
-};
-
-static F32 cubeUVs[6][4][2] = {
-   { { 0, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 } }, // East
-   { { 1, 1 }, { 0, 1 }, { 0, 0 }, { 1, 0 } }, // up
-   { { 1, 0 }, { 1, 1 }, { 0, 1 }, { 0, 0 } }, // west
-   { { 0, 1 }, { 1, 1 }, { 1, 0 }, { 0, 0 } }, // down
-   { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } }, // north
-   { { 1, 1 }, { 0, 1 }, { 0, 0 }, { 1, 0 } }  // south
-};
-
-typedef enum CubeSides {
-   CubeSides_East,
-   CubeSides_Up,
-   CubeSides_West,
-   CubeSides_Down,
-   CubeSides_North,
-   CubeSides_South,
-} CubeSides;
-
-static struct osn_context *osn;
-
-typedef struct GPUVertex {
-   Vec4 position;
-   F32 uvx;
-   F32 uvy;
-} GPUVertex;
-
-typedef U32 GPUIndex;
-
-typedef struct Cube {
-   U16 material : 10; // 1024 material types
-   U16 light : 4;     // 0-15 light level
-   U16 flag1 : 1;     // 1-bit extra flag
-   U16 flag2 : 1;     // 1-bit extra flag
-} Cube;
-
-typedef enum Materials {
-   Material_Air,
-   Material_Bedrock,
-   Material_Dirt,
-   Material_Grass,      // Also note that bottoms of grass have dirt blocks.
-   Material_Grass_Side, // Sides of grass have a special texture.
-   Material_Wood_Trunk,
-   Material_Leaves
-} Material;
-
-// TODO: store a list of pointers of RenderChunk array (RenderChunk**)
-// into a Chunk datastructure. That way we can access the RenderChunk
-// and update it accordingly when we break a block. We can calculate
-// based on the position of the block breaking what position the RenderChunk
-// is in.
-
-typedef struct RenderChunk {
-   GPUVertex *vertexData; /// stretchy buffer
-   GPUIndex *indices;          /// stretchy buffer
-   GPUIndex currentIndex;      /// Current index offset
-   GPUIndex indiceCount;       /// Indice Size
-   S32 vertexCount;       /// VertexData Count 
-
-   GLuint vbo;            /// OpenGL Vertex Buffer Object
-   GLuint ibo;            /// OpenGL Index Buffer Object
-} RenderChunk;
-
-typedef struct Chunk {
-   S32 startX;
-   S32 startZ;
-   Cube *cubeData;                         /// Cube data for full chunk
-   RenderChunk renderChunks[CHUNK_SPLITS]; /// Per-render chunk data.
-} Chunk;
-
-/// ChunkWorld is a flat 2D array that represents the entire
-/// world based upon
-Chunk *gChunkWorld = NULL;
-
 // Grid size but should be variable. This is the 'chunk distance'.
 S32 worldSize = 2;
 
-Chunk* getChunkAt(S32 x, S32 z) {
-   // Since x and z can go from -worldSize to worldSize,
-   // we need to normalize them so that they are always positive.
-   x += worldSize;
-   z += worldSize;
+// Vertical 'chunk distance'.
+S32 worldHeight = 4;
+
+/// How many seconds ahead of the camera's movement chunks are loaded.
+#define CHUNK_PREFETCH_SECONDS 0.5f
+
+/// Default for setChunkUploadBudget, in bytes per frame.
+#define CHUNK_UPLOAD_BUDGET (256 * 1024)
+
+#define WORLD_SEED 0xDEADBEEFULL
+
+/// Written by JeefCraftPregen. Chunks it has don't need to be generated.
+#define WORLD_FILE_NAME "world.jcw"
+
+/// The chunk window is a fixed (worldSize * 2)^2 * (worldHeight * 2) grid of
+/// chunks that follows the camera. It is toroidal: chunk x, y, z always
+/// lives in slot x mod width, y mod height, z mod width. When the camera
+/// crosses a chunk border the chunks that fall off one side are recycled in
+/// place as the new chunks on the other side. Nothing is moved or
+/// reallocated.
+Chunk *gChunkWindow = NULL;
+U32 gChunkUploadBudget = CHUNK_UPLOAD_BUDGET; /// Bytes of meshes uploaded per frame, 0 for no limit.
+bool gWorldLoaded = false;      /// Has the first window finished loading?
+WorldFileReader gWorldFile;     /// Pregenerated chunks, file is NULL if there is no world file.
+Vec3 gLastCameraPosition;       /// Camera position of the previous frame.
+S32 gChunkWindowCenterX;
+S32 gChunkWindowCenterY;
+S32 gChunkWindowCenterZ;
+
+static inline S32 getChunkWindowWidth() {
+   return worldSize * 2;
+}
+
+static inline S32 getChunkWindowHeight() {
+   return worldHeight * 2;
+}
 
-   S32 index = (z * (worldSize * 2)) + x;
-   return &gChunkWorld[index];
+static inline S32 getChunkWindowCount() {
+   return getChunkWindowWidth() * getChunkWindowWidth() * getChunkWindowHeight();
+}
+
+static inline Chunk* getChunkWindowSlot(S32 x, S32 y, S32 z) {
+   S32 width = getChunkWindowWidth();
+   S32 height = getChunkWindowHeight();
+   S32 slotX = ((x % width) + width) % width;
+   S32 slotY = ((y % height) + height) % height;
+   S32 slotZ = ((z % width) + width) % width;
+   return &gChunkWindow[(slotY * width + slotZ) * width + slotX];
 }
 
 GLuint projMatrixLoc;
@@ -138,452 +95,283 @@ GLuint textureLoc;
 U32 program;
 Texture2D textureAtlas;
 
-Cube* getCubeAt(Cube *cubeData, S32 x, S32 y, S32 z) {
-   return &cubeData[x * (MAX_CHUNK_HEIGHT) * (CHUNK_WIDTH) + z * (MAX_CHUNK_HEIGHT) + y];
+F32 getViewDistance() {
+   // Give 1 chunk 'padding' looking forward. The horizon usually reaches
+   // a lot further than the chunks.
+   F32 chunkDistance = (F32)(worldSize * CHUNK_WIDTH + CHUNK_WIDTH);
+   F32 horizonDistance = getHorizonDistance();
+   return horizonDistance > chunkDistance ? horizonDistance : chunkDistance;
 }
 
-#define TEXTURE_ATLAS_COUNT_I 32
-#define TEXTURE_ATLAS_COUNT_F 32.0f
-
-void buildFace(Chunk *chunk, S32 index, S32 side, S32 material, Vec3 localPos) {
-   // Vertex data first, then index data.
+GLuint singleBufferCubeVBO;
 
-   RenderChunk *renderChunk = &chunk->renderChunks[index];
+/// Indices of QUAD_INDEX_MAX_QUADS quads, shared by every chunk and the
+/// picker cube.
+static GLuint gQuadIBO;
 
-   for (S32 i = 0; i < 4; ++i) {
-      GPUVertex v;
-      v.position.x = cubes[side][i][0] + localPos.x;
-      v.position.y = cubes[side][i][1] + localPos.y;
-      v.position.z = cubes[side][i][2] + localPos.z;
-      v.position.w = cubes[side][i][3];
-      v.uvx = (F32)(cubeUVs[side][i][0] + ((F32)(material % TEXTURE_ATLAS_COUNT_I))) / TEXTURE_ATLAS_COUNT_F;
-      v.uvy = (F32)(cubeUVs[side][i][1] + ((F32)(material / TEXTURE_ATLAS_COUNT_I))) / TEXTURE_ATLAS_COUNT_F;
-      sb_push(renderChunk->vertexData, v);
+// Returns the number of bytes uploaded.
+WordSize uploadRenderChunkToGL(RenderChunk *r, ChunkGL *gl) {
+   WordSize size = sizeof(GPUVertex) * r->vertexCount;
+   if (r->vertexCount > 0) {
+      // A remeshed chunk keeps its buffer. The old storage is orphaned
+      // first, so the driver doesn't wait on draws that still use it, and a
+      // mesh that fits is written into the new storage. Otherwise the
+      // buffer is reallocated at the new size. Buffers also shrink once a
+      // mesh would use less than half.
+      if (gl->vbo == 0)
+         glGenBuffers(1, &gl->vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, gl->vbo);
+      if (size <= gl->vboSize && size >= gl->vboSize / 2) {
+         glBufferData(GL_ARRAY_BUFFER, gl->vboSize, NULL, GL_STATIC_DRAW);
+         glBufferSubData(GL_ARRAY_BUFFER, 0, size, r->vertexData);
+      } else {
+         glBufferData(GL_ARRAY_BUFFER, size, r->vertexData, GL_STATIC_DRAW);
+         gl->vboSize = (U32)size;
+      }
    }
-   renderChunk->vertexCount += 4;
-
-   GPUIndex in = renderChunk->currentIndex;
-   sb_push(renderChunk->indices, in);
-   sb_push(renderChunk->indices, in + 2);
-   sb_push(renderChunk->indices, in + 1);
-   sb_push(renderChunk->indices, in);
-   sb_push(renderChunk->indices, in + 3);
-   sb_push(renderChunk->indices, in + 2);
-   renderChunk->currentIndex += 4;
-   renderChunk->indiceCount += 6;
-}
+   gl->quadCount = r->vertexCount / QUAD_VERTEX_COUNT;
 
-F32 getViewDistance() {
-   // Give 1 chunk 'padding' looking forward.
-   return worldSize * CHUNK_WIDTH + CHUNK_WIDTH;
+   // Free right after uploading to the GL. We don't need gpu data
+   // in both system and gpu ram.
+   freeRenderChunkGeometry(r);
+   memset(r, 0, sizeof(RenderChunk));
+   return size;
 }
 
-static inline bool isTransparent(Cube *cubeData, S32 x, S32 y, S32 z) {
-   assert(cubeData);
-   assert(getCubeAt(cubeData, x, y, z));
-   return getCubeAt(cubeData, x, y, z)->material == Material_Air;
+void freeChunkGL(Chunk *chunk) {
+   if (chunk->gl.vbo != 0)
+      glDeleteBuffers(1, &chunk->gl.vbo);
+   memset(&chunk->gl, 0, sizeof(ChunkGL));
 }
 
-static inline bool isTransparentAtCube(Cube *c) {
-   if (c == NULL)
-      return false;
-   return c->material == Material_Air;
+// Swaps the chunk's new mesh in for the old one. Returns the number of
+// bytes uploaded.
+WordSize uploadChunkToGL(Chunk *chunk) {
+   // Nothing to draw any more, give the buffer back.
+   if (chunk->renderChunk.vertexCount == 0)
+      freeChunkGL(chunk);
+   WordSize size = uploadRenderChunkToGL(&chunk->renderChunk, &chunk->gl);
+   chunk->ready = true;
+   return size;
 }
 
-static inline Chunk* getChunkAtWorldSpacePosition(S32 x, S32 y, S32 z) {
-   // first calculate chunk based upon position.
-   S32 chunkX = x < 0 ? ((x + 1) / CHUNK_WIDTH) - 1 : x / CHUNK_WIDTH;
-   S32 chunkZ = z < 0 ? ((z + 1) / CHUNK_WIDTH) - 1 : z / CHUNK_WIDTH;
-
-   // Don't go past.
-   if (chunkX < -worldSize || chunkX >= worldSize || chunkZ < -worldSize || chunkZ >= worldSize)
-      return NULL;
-
-   Chunk *chunk = getChunkAt(chunkX, chunkZ);
-   return chunk;
+void uploadQuadIndicesToGL() {
+   GPUIndex *indices = (GPUIndex*)malloc(sizeof(GPUIndex) * QUAD_INDEX_MAX_QUADS * QUAD_INDEX_COUNT);
+   fillQuadIndices(indices, QUAD_INDEX_MAX_QUADS);
+   glGenBuffers(1, &gQuadIBO);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gQuadIBO);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GPUIndex) * QUAD_INDEX_MAX_QUADS * QUAD_INDEX_COUNT, indices, GL_STATIC_DRAW);
+   free(indices);
 }
 
-static inline RenderChunk* getRenderChunkAtWorldSpacePosition(S32 x, S32 y, S32 z, S32 *renderChunkIndex) {
-   Chunk *chunk = getChunkAtWorldSpacePosition(x, y, z);
-   if (chunk == NULL)
-      return NULL;
-   assert(y >= 0); // Ensure y is >= 0
-   assert(y < MAX_CHUNK_HEIGHT); // Ensure chunk is < MAX_CHUNK_HEIGHT
-
-   *renderChunkIndex = y / RENDER_CHUNK_HEIGHT;
-   return &chunk->renderChunks[*renderChunkIndex];
+void uploadPickerCubeToGL() {
+   // Single buffer cube vbo. Its 6 faces are quads, so it is drawn with
+   // the shared quad indices.
+   glGenBuffers(1, &singleBufferCubeVBO);
+   glBindBuffer(GL_ARRAY_BUFFER, singleBufferCubeVBO);
+   glBufferData(GL_ARRAY_BUFFER, sizeof(F32) * 6 * 4 * 4, cubes, GL_STATIC_DRAW);
 }
 
-static inline void globalPosToLocalPos(S32 x, S32 y, S32 z, S32 *localX, S32 *localY, S32 *localZ) {
-   // first calculate chunk based upon position.
-   S32 chunkX = x < 0 ? ((x + 1) / CHUNK_WIDTH) - 1 : x / CHUNK_WIDTH;
-   S32 chunkZ = z < 0 ? ((z + 1) / CHUNK_WIDTH) - 1 : z / CHUNK_WIDTH;
-   S32 chunkY = y / RENDER_CHUNK_HEIGHT;
-
-   *localX = x - (chunkX * CHUNK_WIDTH);
-   *localZ = z - (chunkZ * CHUNK_WIDTH);
-   *localY = y - (chunkY * RENDER_CHUNK_HEIGHT);
-
-   assert(*localX >= 0);
-   assert(*localZ >= 0);
-   assert(*localY >= 0);
-   assert(*localX < CHUNK_WIDTH);
-   assert(*localZ < CHUNK_WIDTH);
-   assert(*localY < RENDER_CHUNK_HEIGHT);
+// Must be called while the pipeline is paused. Cancels the chunk if it is
+// still being generated.
+static void unloadChunk(Chunk *chunk) {
+   removeChunkFromPipeline(chunk);
+   removeChunk(chunk);
+   freeChunkSection(&chunk->section);
+   freeCaveDensity(chunk);
+   freeRenderChunkGeometry(&chunk->renderChunk);
+   memset(&chunk->renderChunk, 0, sizeof(RenderChunk));
+   freeChunkGL(chunk);
+   chunk->loaded = false;
+   chunk->ready = false;
+   chunk->status = ChunkStatus_Empty;
 }
 
-static inline Cube* getGlobalCubeAtWorldSpacePosition(S32 x, S32 y, S32 z) {
-   // first calculate chunk based upon position.
-   S32 chunkX = x < 0 ? ((x + 1) / CHUNK_WIDTH) - 1 : x / CHUNK_WIDTH;
-   S32 chunkZ = z < 0 ? ((z + 1) / CHUNK_WIDTH) - 1 : z / CHUNK_WIDTH;
-
-   // Don't go past.
-   if (chunkX < -worldSize || chunkX >= worldSize || chunkZ < -worldSize || chunkZ >= worldSize)
-      return NULL;
-
-   Chunk *chunk = getChunkAt(chunkX, chunkZ);
-
-   S32 localChunkX = x - (chunkX * CHUNK_WIDTH);
-   S32 localChunkZ = z - (chunkZ * CHUNK_WIDTH);
-
-   assert(localChunkX >= 0);
-   assert(localChunkZ >= 0);
-   assert(localChunkX < CHUNK_WIDTH);
-   assert(localChunkZ < CHUNK_WIDTH);
-
-   return getCubeAt(chunk->cubeData, localChunkX, y, localChunkZ);
-}
-
-// Worldspace
-static bool shouldCave(S32 x, S32 y, S32 z) {
-   F64 cave_stretch = 24.0;
-
-   F64 noise = 0.0;
-   for (S32 i = 0; i < 6; ++i) {
-      F64 factor = cave_stretch * ((F64)((1 << i) / 3) + 1.0);
-
-      noise += (open_simplex_noise3(
-         osn,
-         (F64)(x) / factor * (F64)(1 << i),
-         (F64)y / factor * (F64)(1 << (i + 1)),
-         (F64)(z) / factor * (F64)(1 << i)
-      ) + 1.0) / (F64)(1 << (i + 1));
+// Sends a meshed chunk back to be remeshed. Must be called while the
+// pipeline is paused. The old mesh is drawn until the new one is uploaded.
+static void markGeometryDirty(Chunk *chunk) {
+   if (chunk != NULL && chunk->status == ChunkStatus_Meshed) {
+      chunk->status = ChunkStatus_Decorated;
+      addChunkToPipeline(chunk);
    }
-
-   return noise >= 1.33;
 }
 
-static S32 solidCubesAroundCubeAt(S32 x, S32 y, S32 z, S32 worldX, S32 worldZ) {
-   S32 solidCount = 0;
-   solidCount += !isTransparentAtCube(getGlobalCubeAtWorldSpacePosition(x + worldX - 1, y, z + worldZ)) && !shouldCave(x + worldX - 1, y, z + worldZ);
-   solidCount += !isTransparentAtCube(getGlobalCubeAtWorldSpacePosition(x + worldX + 1, y, z + worldZ)) && !shouldCave(x + worldX + 1, y, z + worldZ);
-   solidCount += !isTransparentAtCube(getGlobalCubeAtWorldSpacePosition(x + worldX, y - 1, z + worldZ)) && !shouldCave(x + worldX, y - 1, z + worldZ);
-   solidCount += !isTransparentAtCube(getGlobalCubeAtWorldSpacePosition(x + worldX, y + 1, z + worldZ)) && !shouldCave(x + worldX, y + 1, z + worldZ);
-   solidCount += !isTransparentAtCube(getGlobalCubeAtWorldSpacePosition(x + worldX, y, z - 1 + worldZ)) && !shouldCave(x + worldX, y, z - 1 + worldZ);
-   solidCount += !isTransparentAtCube(getGlobalCubeAtWorldSpacePosition(x + worldX, y, z + 1 + worldZ)) && !shouldCave(x + worldX, y, z + 1 + worldZ);
-   return solidCount;
+// Sends the loaded neighbours of a chunk back to be remeshed.
+static void markNeighbourGeometryDirty(Chunk *chunk) {
+   for (S32 i = 0; i < ChunkNeighbour_Count; ++i)
+      markGeometryDirty(chunk->neighbours[i]);
 }
 
-void generateWorld(S32 chunkX, S32 chunkZ, S32 worldX, S32 worldZ) {
-   // We modulate divide CHUNK_WIDTH as we keep the grid static
-   // no matter where we move around on the map.
-   // Say we go west, well, the first 'west' chunks are replaced by new chunks.
-   // TODO: This doesn't work quite yet, and we might need to use chunk
-   // pointers so we can easilly rearrange the world.
-   // Or maybe a memcpy will be fine, who knows.
-
-   Chunk *chunk = getChunkAt(chunkX, chunkZ);
-   chunk->cubeData = (Cube*)calloc(CHUNK_SIZE, sizeof(Cube));
-   Cube *cubeData = chunk->cubeData;
-
-   F64 stretchFactor = 20.0;
-
-   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
-      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
-         // calculate height for each cube.
-         // Taking absolute value will allow for only 0-1 scaling.
-         // also make sure to use the world coordinates
-
-         // Smoothen the noise based on 5 blocks surrounding it.
-         F64 noise = (open_simplex_noise2(osn, (F64)(x + worldX) / stretchFactor, (F64)(z + worldZ) / stretchFactor)) * 10.0;
-         for (S32 i = -5; i < 5; ++i) {
-            for (S32 j = -5; j < 5; ++j) {
-               noise += (open_simplex_noise2(osn, (F64)(x + i + worldX) / (stretchFactor + i), (F64)(z + j + worldZ) / (stretchFactor + j)) * (10.0 + j)) / 2.0f;
-            }
-            noise /= 10.f;
-         }
-         //F64 noise = fabs(open_simplex_noise2(osn, (F64)(x + worldX) / stretchFactor, (F64)(z + worldZ) / stretchFactor) * 10.0);
-         S32 height = (S32)(noise) + 70.0f; // 70 as base height.
-
-         // Make block at height level grass.
-         getCubeAt(cubeData, x, height, z)->material = Material_Grass;
-
-         // Need to make air for anything above height.
-         // Anything below height is just block the whole way till last couple rows which
-         // are bedrock.
-         for (S32 y = height + 1; y < MAX_CHUNK_HEIGHT; ++y) {
-            // All air
-            getCubeAt(cubeData, x, y, z)->material = Material_Air;
-         }
-         for (S32 y = 4; y < height; ++y) {
-            // All dirt.
-            // todo: this is where we do stuff like caves!
-            // but of course in a second pass, or third pass...!
-            getCubeAt(cubeData, x, y, z)->material = Material_Dirt;
-         }
-         for (S32 y = 0; y < 4; ++y) {
-            // All bedrock
-            getCubeAt(cubeData, x, y, z)->material = Material_Bedrock;
-         }
-      }
+/// Recenters the chunk window on the chunk the camera is in. Only the
+/// slices that scrolled into view are queued for generation. They are
+/// meshed along with the chunks bordering them, and any chunk that lost a
+/// neighbour, so the faces at the seams and at the edge of the world are
+/// correct. Chunks that fall out of the window are cancelled.
+/// @param force Reload every slot regardless of where the window was.
+static void updateChunkWindow(bool force) {
+   flushWorldEdits();
+
+   Vec3 cameraPos;
+   getCameraPosition(&cameraPos);
+   S32 centerX = (S32)floorf(cameraPos.x / (F32)CHUNK_WIDTH);
+   S32 centerY = (S32)floorf(cameraPos.y / (F32)CHUNK_HEIGHT);
+   S32 centerZ = (S32)floorf(cameraPos.z / (F32)CHUNK_WIDTH);
+
+   if (!force && centerX == gChunkWindowCenterX && centerY == gChunkWindowCenterY && centerZ == gChunkWindowCenterZ)
+      return;
+   gChunkWindowCenterX = centerX;
+   gChunkWindowCenterY = centerY;
+   gChunkWindowCenterZ = centerZ;
+
+   S32 minX = centerX - worldSize;
+   S32 maxX = centerX + worldSize;
+   S32 minY = centerY - worldHeight;
+   S32 maxY = centerY + worldHeight;
+   S32 minZ = centerZ - worldSize;
+   S32 maxZ = centerZ + worldSize;
+
+   // The workers must not be reading the chunks around the ones we swap.
+   pauseChunkPipeline();
+
+   // Drop the chunks that fell out of the window first so that their slots
+   // can be reused.
+   for (S32 i = 0; i < getChunkWindowCount(); ++i) {
+      Chunk *chunk = &gChunkWindow[i];
+      if (!chunk->loaded)
+         continue;
+      if (chunk->startX >= minX && chunk->startX < maxX &&
+          chunk->startY >= minY && chunk->startY < maxY &&
+          chunk->startZ >= minZ && chunk->startZ < maxZ)
+         continue;
+
+      markNeighbourGeometryDirty(chunk);
+      unloadChunk(chunk);
    }
-}
-
-void generateCavesAndStructures(S32 chunkX, S32 chunkZ, S32 worldX, S32 worldZ) {
-
-   Chunk *chunk = getChunkAt(chunkX, chunkZ);
-   Cube *cubeData = chunk->cubeData;
 
-   // Generate caves.
-   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
-      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
-         for (S32 y = 0; y < MAX_CHUNK_HEIGHT; ++y) {
-            Cube *c = getCubeAt(cubeData, x, y, z);
-            if (c->material == Material_Bedrock)
+   // Queue the new chunks. Their neighbours have to be remeshed once they
+   // are generated.
+   for (S32 x = minX; x < maxX; ++x) {
+      for (S32 z = minZ; z < maxZ; ++z) {
+         for (S32 y = minY; y < maxY; ++y) {
+            Chunk *chunk = getChunkWindowSlot(x, y, z);
+            if (chunk->loaded)
                continue;
-            if (c->material == Material_Air)
-               break;
-
-            if (shouldCave(x + worldX, y, z + worldZ)) {
-               // Perform smothing.
-               S32 solidCount = solidCubesAroundCubeAt(x, y, z, worldX, worldZ);
-               if (solidCount < 4) {
-                  // It's a cave, carve out air.
-                  c->material = Material_Air;
-               }
-            }
-         }
-      }
-   }
 
-   // Generate Trees
-   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
-      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
-         // Find the height. Skip over anything that isn't the height.
-         // and we only care about grass.
-         S32 height = MAX_CHUNK_HEIGHT - 1;
-         for (; height >= 0; --height) {
-            if (getCubeAt(cubeData, x, height, z)->material != Material_Air) {
-               break;
-            }
-         }
-
-         if (getCubeAt(cubeData, x, height, z)->material == Material_Grass) {
-            // Lets generate some trees.
-            //
-            // Also, a tree only has a 1/10 chance of spawning on this block.
-            S32 posX = x;
-            S32 posZ = z;
-            if (open_simplex_noise2(osn, (F64)posX + worldX, (F64)posZ + worldZ) >= 0.8) {
-               getCubeAt(cubeData, x, height + 1, z)->material = Material_Wood_Trunk;
-               getCubeAt(cubeData, x, height + 2, z)->material = Material_Wood_Trunk;
-               getCubeAt(cubeData, x, height + 3, z)->material = Material_Wood_Trunk;
-               for (S32 xxx = x - 3; xxx < x + 3; ++xxx) {
-                  if (xxx >= CHUNK_WIDTH)
-                     break;
-                  else if (xxx < 0)
-                     continue;
-                  for (S32 zzz = z - 3; zzz < z + 3; ++zzz) {
-                     if (zzz >= CHUNK_WIDTH)
-                        break;
-                     else if (zzz < 0)
-                        continue;
-                     getCubeAt(cubeData, xxx, height + 4, zzz)->material = Material_Leaves;
-                  }
-               }
-            }
+            chunk->startX = x;
+            chunk->startY = y;
+            chunk->startZ = z;
+            chunk->loaded = true;
+            chunk->status = ChunkStatus_Empty;
+            insertChunk(chunk);
+
+            // A pregenerated chunk already has its trees, it only needs
+            // to be meshed.
+            if (gWorldFile.file != NULL && readWorldFileChunk(&gWorldFile, chunk))
+               chunk->status = ChunkStatus_Decorated;
+            markNeighbourGeometryDirty(chunk);
+            addChunkToPipeline(chunk);
          }
       }
    }
-}
 
-void generateGeometryForRenderChunk(Chunk *chunk, S32 renderChunkId) {
-   Cube *cubeData = chunk->cubeData;
-   S32 chunkX = chunk->startX;
-   S32 chunkZ = chunk->startZ;
-
-   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
-      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
-         for (S32 j = 0; j < RENDER_CHUNK_HEIGHT; ++j) {
-            S32 y = (RENDER_CHUNK_HEIGHT * renderChunkId) + j;
-            Vec3 localPos;
-            localPos.x = (F32)x;
-            localPos.y = (F32)y;
-            localPos.z = (F32)z;
-
-            // skip if current block is transparent.
-            if (isTransparent(cubeData, x, y, z))
-               continue;
-
-            // Cross chunk checking. Only need to check x and z axes.
-            // If the next *chunk* over is is transparent then ya we have
-            // to render regardless.
-            bool isOpaqueNegativeX = false;
-            bool isOpaquePositiveX = false;
-            bool isOpaqueNegativeZ = false;
-            bool isOpaquePositiveZ = false;
-
-            if (x == 0 && chunkX > -worldSize) {
-               Cube *behindData = getChunkAt(chunkX - 1, chunkZ)->cubeData;
-               if (!isTransparent(behindData, CHUNK_WIDTH - 1, y, z)) {
-                  // The cube behind us on the previous chunk is in fact
-                  // transparent. We need to render this face.
-                  isOpaqueNegativeX = true;
-               }
-            }
-            if (x == (CHUNK_WIDTH - 1) && (chunkX + 1) < worldSize) {
-               Cube *behindData = getChunkAt(chunkX + 1, chunkZ)->cubeData;
-               if (!isTransparent(behindData, 0, y, z)) {
-                  // The cube behind us on the previous chunk is in fact
-                  // transparent. We need to render this face.
-                  isOpaquePositiveX = true;
-               }
-            }
-            if (z == 0 && chunkZ > -worldSize) {
-               Cube *behindData = getChunkAt(chunkX, chunkZ - 1)->cubeData;
-               if (!isTransparent(behindData, x, y, CHUNK_WIDTH - 1)) {
-                  // The cube behind us on the previous chunk is in fact
-                  // transparent. We need to render this face.
-                  isOpaqueNegativeZ = true;
-               }
-            }
-            if (z == (CHUNK_WIDTH - 1) && (chunkZ + 1) < worldSize) {
-               Cube *behindData = getChunkAt(chunkX, chunkZ + 1)->cubeData;
-               if (!isTransparent(behindData, x, y, 0)) {
-                  // The cube behind us on the previous chunk is in fact
-                  // transparent. We need to render this face.
-                  isOpaquePositiveZ = true;
-               }
-            }
-
-            // check all 6 directions to see if the cube is exposed.
-            // If the cube is exposed in that direction, render that face.
-
-            S32 material = getCubeAt(cubeData, x, y, z)->material;
-
-            if (y >= (MAX_CHUNK_HEIGHT - 1) || isTransparent(cubeData, x, y + 1, z))
-               buildFace(chunk, renderChunkId, CubeSides_Up, material, localPos);
-
-            // If this is grass, bottom has to be dirt.
-
-            if (y == 0 || isTransparent(cubeData, x, y - 1, z))
-               buildFace(chunk, renderChunkId, CubeSides_Down, (material == Material_Grass ? Material_Dirt : material), localPos);
-
-            // After we built the top, this is a special case for grass.
-            // If we are actually building grass sides it has to be special.
-            if (material == Material_Grass)
-               material = Material_Grass_Side;
-
-            if ((!isOpaqueNegativeX && x == 0) || (x > 0 && isTransparent(cubeData, x - 1, y, z)))
-               buildFace(chunk, renderChunkId, CubeSides_West, material, localPos);
-
-            if ((!isOpaquePositiveX && x >= (CHUNK_WIDTH - 1)) || (x < (CHUNK_WIDTH - 1) && isTransparent(cubeData, x + 1, y, z)))
-               buildFace(chunk, renderChunkId, CubeSides_East, material, localPos);
-
-            if ((!isOpaqueNegativeZ && z == 0) || (z > 0 && isTransparent(cubeData, x, y, z - 1)))
-               buildFace(chunk, renderChunkId, CubeSides_South, material, localPos);
-
-            if ((!isOpaquePositiveZ && z >= (CHUNK_WIDTH - 1)) || (z < (CHUNK_WIDTH - 1) && isTransparent(cubeData, x, y, z + 1)))
-               buildFace(chunk, renderChunkId, CubeSides_North, material, localPos);
-         }
-      }
-   }
+   resumeChunkPipeline();
 }
 
-void generateGeometry(Chunk *chunk) {
-   for (S32 i = 0; i < CHUNK_SPLITS; ++i) {
-      generateGeometryForRenderChunk(chunk, i);
-   }
+/// Where chunk loading is centered this frame.
+typedef struct ChunkLoadFocus {
+   Vec3 position; /// Where the camera is expected to be shortly.
+   Vec3 forward;  /// Direction the camera is looking in.
+} ChunkLoadFocus;
+
+// Chunks are loaded nearest first, measured from where the camera is
+// heading. Chunks in front of the camera count as up to twice as close as
+// the ones behind it.
+static F32 getChunkLoadPriority(const Chunk *chunk, void *userData) {
+   ChunkLoadFocus *focus = (ChunkLoadFocus*)userData;
+   Vec3 center = create_vec3(
+      ((F32)chunk->startX + 0.5f) * (F32)CHUNK_WIDTH,
+      ((F32)chunk->startY + 0.5f) * (F32)CHUNK_HEIGHT,
+      ((F32)chunk->startZ + 0.5f) * (F32)CHUNK_WIDTH
+   );
+   Vec3 offset;
+   glm_vec_sub(center.vec, focus->position.vec, offset.vec);
+
+   F32 distance = sqrtf(glm_vec_dot(offset.vec, offset.vec));
+   if (distance < 1.0f)
+      return distance;
+
+   F32 facing = glm_vec_dot(offset.vec, focus->forward.vec) / distance;
+   return distance * (1.5f - 0.5f * facing);
 }
 
-GLuint singleBufferCubeVBO;
-GLuint singleBufferCubeIBO;
-
-void uploadRenderChunkToGL(RenderChunk *r) {
-   if (r->vertexCount > 0) {
-      glGenBuffers(1, &r->vbo);
-      glGenBuffers(1, &r->ibo);
-
-      glBindBuffer(GL_ARRAY_BUFFER, r->vbo);
-      glBufferData(GL_ARRAY_BUFFER, sizeof(GPUVertex) * r->vertexCount, r->vertexData, GL_STATIC_DRAW);
-
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r->ibo);
-      glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GPUIndex) * r->indiceCount, r->indices, GL_STATIC_DRAW);
+/// Reorders the chunks waiting to be generated by how soon the camera will
+/// see them.
+/// @param dt The time since the last frame in milliseconds.
+static void prioritizeChunkLoading(F32 dt) {
+   Vec3 cameraPos;
+   getCameraPosition(&cameraPos);
+
+   // Follow the camera's movement so the chunks it is heading for are there
+   // when it arrives.
+   Vec3 velocity = create_vec3(0.0f, 0.0f, 0.0f);
+   if (dt > 0.0f) {
+      glm_vec_sub(cameraPos.vec, gLastCameraPosition.vec, velocity.vec);
+      glm_vec_scale(velocity.vec, 1000.0f / dt, velocity.vec);
    }
+   gLastCameraPosition = cameraPos;
 
-   // Free right after uploading to the GL. We don't need gpu data
-   // in both system and gpu ram.
-   sb_free(r->vertexData);
-   sb_free(r->indices);
-}
+   ChunkLoadFocus focus;
+   glm_vec_scale(velocity.vec, CHUNK_PREFETCH_SECONDS, focus.position.vec);
+   glm_vec_add(focus.position.vec, cameraPos.vec, focus.position.vec);
 
-void uploadChunkToGL(Chunk *chunk) {
-   for (S32 i = 0; i < CHUNK_SPLITS; ++i) {
-      RenderChunk *r = &chunk->renderChunks[i];
-      uploadRenderChunkToGL(r);
-   }
-}
+   // The camera looks down -z in view space.
+   mat4 view;
+   getCurrentViewMatrix(&view);
+   focus.forward = create_vec3(-view[0][2], -view[1][2], -view[2][2]);
 
-static inline void freeRenderChunkGL(RenderChunk *r) {
-   if (r->vertexCount > 0) {
-      glDeleteBuffers(1, &r->vbo);
-      glDeleteBuffers(1, &r->ibo);
-   }
-   memset(r, 0, sizeof(RenderChunk));
+   prioritizeChunkPipeline(getChunkLoadPriority, &focus);
 }
 
-void freeChunkGL(Chunk *chunk) {
-   for (S32 i = 0; i < CHUNK_SPLITS; ++i) {
-      RenderChunk *r = &chunk->renderChunks[i];
-      freeRenderChunkGL(r);
-   }
+// Report how much the cube data is costing us compared to storing a full
+// Cube for every position in the world.
+static void printWorldMemoryReport() {
+   WordSize cubeMemory = 0;
+   U32 iterator = 0;
+   Chunk *chunk;
+   while ((chunk = (Chunk*)hashMapNext(&gChunkMap, &iterator, NULL)) != NULL)
+      cubeMemory += getChunkSectionMemoryUsage(&chunk->section);
+   WordSize flatMemory = (WordSize)gChunkMap.count * CHUNK_SIZE * sizeof(Cube);
+   printf("Cube data: %lu KB (%lu KB uncompressed)\n", (unsigned long)(cubeMemory / 1024), (unsigned long)(flatMemory / 1024));
+
+   PoolStats sectionStats;
+   getChunkSectionPoolStats(&sectionStats);
+   const PoolStats *meshStats = getMeshScratchStats();
+   printf("Section pools: %u live, %u peak, %.0f%% reused\n", sectionStats.liveCount, sectionStats.highWaterMark, getPoolReuseRate(&sectionStats) * 100.0);
+   printf("Mesh scratch: %u live, %u peak, %.0f%% reused\n", meshStats->liveCount, meshStats->highWaterMark, getPoolReuseRate(meshStats) * 100.0);
 }
 
-void uploadGeometryToGL() {
-   // *Single threaded*
-   //
-   // Upload to the GL
-   // Now that we generated all of the geometry, upload to the GL.
-   // Note if a chunk has no geometry we don't create a vbo
-   //
-   // TODO: use VAO if extension is supported??
-   for (S32 x = -worldSize; x < worldSize; ++x) {
-      for (S32 z = -worldSize; z < worldSize; ++z) {
-         uploadChunkToGL(getChunkAt(x, z));
+/// Uploads the meshes the pipeline finished, in the order they finished,
+/// until budget bytes have gone to the GL. The GL context lives on this
+/// thread. The mesh that crosses the budget still goes, so every frame
+/// makes progress. The rest wait with the pipeline for the next frame
+/// while their old meshes keep drawing.
+/// @param budget The most bytes to upload, or 0 to upload everything.
+static void uploadFinishedChunks(U32 budget) {
+   WordSize uploaded = 0;
+   bool drained = false;
+   while (budget == 0 || uploaded < budget) {
+      Chunk *chunk;
+      if (collectFinishedChunks(&chunk, 1) == 0) {
+         drained = true;
+         break;
       }
+      uploaded += uploadChunkToGL(chunk);
    }
 
-   // Single buffer cube vbo/ibo
-   glGenBuffers(1, &singleBufferCubeVBO);
-   glBindBuffer(GL_ARRAY_BUFFER, singleBufferCubeVBO);
-   glBufferData(GL_ARRAY_BUFFER, sizeof(F32) * 6 * 4 * 4, cubes, GL_STATIC_DRAW);
-
-   glGenBuffers(1, &singleBufferCubeIBO);
-   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, singleBufferCubeIBO);
-   
-   GPUIndex indices[36];
-   S32 in = 0;
-   for (S32 i = 0; i < 36; i += 6) {
-      indices[i] = in;
-      indices[i + 1] = in + 2;
-      indices[i + 2] = in + 1;
-      indices[i + 3] = in;
-      indices[i + 4] = in + 3;
-      indices[i + 5] = in + 2;
-
-      in += 4;
+   if (!gWorldLoaded && drained && getChunkPipelineQueueCount() == 0) {
+      gWorldLoaded = true;
+      printWorldMemoryReport();
    }
-   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GPUIndex) * 36, indices, GL_STATIC_DRAW);
 }
 
 int gVisibleChunks = 0;
@@ -616,130 +404,136 @@ void initWorld() {
    pickerShaderProjMatrixLoc = glGetUniformLocation(pickerProgram, "projViewMatrix");
    pickerShaderModelMatrixLoc = glGetUniformLocation(pickerProgram, "modelMatrix");
 
-   open_simplex_noise((U64)0xDEADBEEF, &osn);
+   initWorldGen((U64)WORLD_SEED);
+   initHorizon();
+   openWorldFile(&gWorldFile, WORLD_FILE_NAME, (U64)WORLD_SEED);
 
    // world grid
-   gChunkWorld = (Chunk*)calloc((worldSize * 2) * (worldSize * 2), sizeof(Chunk));
-   gTotalChunks = worldSize * 2 * worldSize * 2 * CHUNK_SPLITS;
-
-   // Easilly put each chunk in a thread in here.
-   // nothing OpenGL, all calculation and world generation.
-//#pragma omp parallel for
-   for (S32 x = -worldSize; x < worldSize; ++x) {
-      for (S32 z = -worldSize; z < worldSize; ++z) {
-         // World position calcuation before passing.
-         generateWorld(x, z, x * CHUNK_WIDTH, z * CHUNK_WIDTH);
-      }
-   }
-
-   // TODO MULTITHREADED: sync here before generating the Geometry.
-
-   // Generate caves and tree
-//#pragma omp parallel for
-   for (S32 x = -worldSize; x < worldSize; ++x) {
-      for (S32 z = -worldSize; z < worldSize; ++z) {
-         generateCavesAndStructures(x, z, x * CHUNK_WIDTH, z * CHUNK_WIDTH);
-      }
-   }
-
-   // Easilly put each chunk in a thread in here.
-   // nothing OpenGL, all calculation and world generation.
-//#pragma omp parallel for
-   for (S32 x = -worldSize; x < worldSize; ++x) {
-      for (S32 z = -worldSize; z < worldSize; ++z) {
-         Chunk * chunk = getChunkAt(x, z);
-         chunk->startX = x;
-         chunk->startZ = z;
-         generateGeometry(chunk);
-      }
-   }
-
-   // TODO MULTITHREADED: sync here before GL upload.
+   initChunkSectionPools();
+   initMeshScratch();
+   initChunkPipeline(-1);
+   initHashMap(&gChunkMap, getChunkWindowCount());
+   initHashMap(&gChunkColumnMap, getChunkWindowWidth() * getChunkWindowWidth());
+   gChunkWindow = (Chunk*)calloc(getChunkWindowCount(), sizeof(Chunk));
+   gTotalChunks = getChunkWindowCount();
+   gWorldLoaded = false;
+   getCameraPosition(&gLastCameraPosition);
+
+   // Only queues the window, the chunks show up as they are generated.
+   updateChunkWindow(true);
+   uploadQuadIndicesToGL();
+   uploadPickerCubeToGL();
+}
 
-   uploadGeometryToGL();
+void finishWorldLoading() {
+   flushWorldEdits();
+   waitForChunkPipeline();
+   uploadFinishedChunks(0);
 }
 
 void freeWorld() {
-   for (S32 x = -worldSize; x < worldSize; ++x) {
-      for (S32 z = -worldSize; z < worldSize; ++z) {
-         Chunk *c = getChunkAt(x, z);
-         free(c->cubeData);
-         freeChunkGL(c);
-      }
+   flushWorldEdits();
+   pauseChunkPipeline();
+   for (S32 i = 0; i < getChunkWindowCount(); ++i) {
+      if (gChunkWindow[i].loaded)
+         unloadChunk(&gChunkWindow[i]);
    }
-
-   free(gChunkWorld);
-   open_simplex_noise_free(osn);
+   freeChunkPipeline();
+
+   free(gChunkWindow);
+   freeHashMap(&gChunkMap);
+   freeHashMap(&gChunkColumnMap);
+   freeChunkSectionPools();
+   freeMeshScratch();
+   freeHorizon();
+   closeWorldFileReader(&gWorldFile);
+   freeWorldGen();
+   glDeleteBuffers(1, &gQuadIBO);
 }
 
-void freeGenerateUpdate(Chunk *c, RenderChunk *r, S32 renderChunkId) {
-   assert(c);
-   assert(r);
-
-   freeRenderChunkGL(r);
-   generateGeometryForRenderChunk(c, renderChunkId);
-   uploadRenderChunkToGL(r);
+void setChunkUploadBudget(U32 bytesPerFrame) {
+   gChunkUploadBudget = bytesPerFrame;
 }
 
-void removeCubeAtWorldPosition(Cube *cube, S32 x, S32 y, S32 z) {
+void removeCubeAtWorldPosition(S32 x, S32 y, S32 z) {
    // Bounds check on removing cube if we are at a boundary.
-   if (x == -worldSize * CHUNK_WIDTH ||
-      x == worldSize * CHUNK_WIDTH ||
-      z == -worldSize * CHUNK_WIDTH ||
-      z == worldSize * CHUNK_WIDTH ||
-      y == 0 ||
-      y == MAX_CHUNK_HEIGHT) {
+   if (y <= 0) {
       printf("Cannot remove cube at %d %d %d. It is at a world edge boundary!\n", x, y, z);
       return;
    }
 
-   cube->material = Material_Air;
-
-   // Rebuild this *render chunk*
-   S32 renderChunkId;
-   Chunk *c = getChunkAtWorldSpacePosition(x, y, z);
-   RenderChunk *r = getRenderChunkAtWorldSpacePosition(x, y, z, &renderChunkId);
-   freeGenerateUpdate(c, r, renderChunkId);
-
-   // Check x,y,z axes to see if they lay on render chunk boundaries.
-   // If they do, we need to update the render chunk that is next to it.
-   S32 localX, localY, localZ;
-   globalPosToLocalPos(x, y, z, &localX, &localY, &localZ);
-
-   if (localX == 0) {
-      c = getChunkAtWorldSpacePosition(x - CHUNK_WIDTH, y, z);
-      r = getRenderChunkAtWorldSpacePosition(x - CHUNK_WIDTH, y, z, &renderChunkId);
-      freeGenerateUpdate(c, r, renderChunkId);
-   } else if (localX >= (CHUNK_WIDTH - 1)) {
-      c = getChunkAtWorldSpacePosition(x + CHUNK_WIDTH, y, z);
-      r = getRenderChunkAtWorldSpacePosition(x + CHUNK_WIDTH, y, z, &renderChunkId);
-      freeGenerateUpdate(c, r, renderChunkId);
-   }
-
-   if (localY == 0) {
-      c = getChunkAtWorldSpacePosition(x, y - RENDER_CHUNK_HEIGHT, z);
-      r = getRenderChunkAtWorldSpacePosition(x, y - RENDER_CHUNK_HEIGHT, z, &renderChunkId);
-      freeGenerateUpdate(c, r, renderChunkId);
-   } else if (localY >= (RENDER_CHUNK_HEIGHT - 1)) {
-      c = getChunkAtWorldSpacePosition(x, y + RENDER_CHUNK_HEIGHT, z);
-      r = getRenderChunkAtWorldSpacePosition(x, y + RENDER_CHUNK_HEIGHT, z, &renderChunkId);
-      freeGenerateUpdate(c, r, renderChunkId);
-   }
+   // Cubes can only be changed once generation is done with them.
+   BlockCursor cursor;
+   initBlockCursor(&cursor, x, y, z);
+   if (cursor.chunk == NULL || !cursor.chunk->ready)
+      return;
 
-   if (localZ == 0) {
-      c = getChunkAtWorldSpacePosition(x, y, z - CHUNK_WIDTH);
-      r = getRenderChunkAtWorldSpacePosition(x, y, z - CHUNK_WIDTH, &renderChunkId);
-      freeGenerateUpdate(c, r, renderChunkId);
-   } else if (localZ >= (CHUNK_WIDTH - 1)) {
-      c = getChunkAtWorldSpacePosition(x, y, z + CHUNK_WIDTH);
-      r = getRenderChunkAtWorldSpacePosition(x, y, z + CHUNK_WIDTH, &renderChunkId);
-      freeGenerateUpdate(c, r, renderChunkId);
-   }
+   beginWorldEdit();
+   setBlockCursorCube(&cursor, Material_Air);
+
+   // Remesh this chunk once the edits are flushed.
+   Chunk *c = cursor.chunk;
+   markChunkDirty(c);
+
+   // Check x,y,z axes to see if they lay on chunk boundaries.
+   // If they do, we need to update the chunk that is next to it.
+   // Neighbours that aren't loaded are skipped.
+   if (cursor.x == 0)
+      markChunkDirty(c->neighbours[ChunkNeighbour_NegativeX]);
+   else if (cursor.x >= (CHUNK_WIDTH - 1))
+      markChunkDirty(c->neighbours[ChunkNeighbour_PositiveX]);
+
+   if (cursor.y == 0)
+      markChunkDirty(c->neighbours[ChunkNeighbour_NegativeY]);
+   else if (cursor.y >= (CHUNK_HEIGHT - 1))
+      markChunkDirty(c->neighbours[ChunkNeighbour_PositiveY]);
+
+   if (cursor.z == 0)
+      markChunkDirty(c->neighbours[ChunkNeighbour_NegativeZ]);
+   else if (cursor.z >= (CHUNK_WIDTH - 1))
+      markChunkDirty(c->neighbours[ChunkNeighbour_PositiveZ]);
 }
 
 bool orthoFlag = false;
 
+// Calculates how many ray steps it takes to leave the section that the
+// point is currently in.
+static S32 getRaySectionExitSteps(Vec3 point, Vec4 rayDir, F32 stepSize) {
+   F32 sectionMin[3];
+   sectionMin[0] = floorf(point.x / (F32)CHUNK_WIDTH) * (F32)CHUNK_WIDTH;
+   sectionMin[1] = floorf(point.y / (F32)CHUNK_HEIGHT) * (F32)CHUNK_HEIGHT;
+   sectionMin[2] = floorf(point.z / (F32)CHUNK_WIDTH) * (F32)CHUNK_WIDTH;
+
+   F32 sectionSize[3] = { (F32)CHUNK_WIDTH, (F32)CHUNK_HEIGHT, (F32)CHUNK_WIDTH };
+
+   F32 exitDistance = 1.0e30f;
+   for (S32 axis = 0; axis < 3; ++axis) {
+      F32 dir = rayDir.vec[axis];
+      F32 distance;
+      if (dir > 0.0f)
+         distance = (sectionMin[axis] + sectionSize[axis] - point.vec[axis]) / dir;
+      else if (dir < 0.0f)
+         distance = (sectionMin[axis] - point.vec[axis]) / dir;
+      else
+         continue;
+
+      if (distance < exitDistance)
+         exitDistance = distance;
+   }
+
+   // We land on the last step inside of the section; the next step of the
+   // loop moves us across the boundary.
+   S32 steps = (S32)(exitDistance / stepSize);
+   return steps > 0 ? steps - 1 : 0;
+}
+
 void renderWorld(F32 dt) {
+   // Scroll the world along with the camera and pick up whatever the
+   // pipeline finished in the background.
+   updateChunkWindow(false);
+   prioritizeChunkLoading(dt);
+   uploadFinishedChunks(gChunkUploadBudget);
+
    // Set GL State
    glEnable(GL_CULL_FACE);
    glCullFace(GL_BACK);
@@ -781,61 +575,100 @@ void renderWorld(F32 dt) {
    Frustum frustum;
    getCameraFrustum(&frustum);
 
-   for (S32 x = -worldSize; x < worldSize; ++x) {
-      for (S32 z = -worldSize; z < worldSize; ++z) {
-         Chunk *c = getChunkAt(x, z);
-         for (S32 i = 0; i < CHUNK_SPLITS; ++i) {
-            if (c->renderChunks[i].vertexCount > 0) {
-               gTotalVisibleChunks++;
-
-               // Set position.
-               // Center y pos should actually be RENDER_CHUNK_HEIGHT * i
-               // but pos should always be 0 for y since the pos is baked into the y coord.
-               Vec3 pos = create_vec3(x * CHUNK_WIDTH, 0, z * CHUNK_WIDTH);
-               Vec3 center;
-               Vec3 halfExtents = create_vec3(CHUNK_WIDTH / 2.0f, RENDER_CHUNK_HEIGHT / 2.0f, CHUNK_WIDTH / 2.0f);
-               glm_vec_add(pos.vec, halfExtents.vec, center.vec);
-               center.y += (F32)(i * RENDER_CHUNK_HEIGHT); // We add since we already have RENDER_CHUNK_HEIGHT / 2.0
-
-               if (FrustumCullSquareBox(&frustum, center, CHUNK_WIDTH / 2.0f)) {
-                  mat4 modelMatrix;
-                  glm_mat4_identity(modelMatrix);
-                  glm_translate(modelMatrix, pos.vec);
-                  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &(modelMatrix[0][0]));
-                  glBindBuffer(GL_ARRAY_BUFFER, c->renderChunks[i].vbo);
-                  glEnableVertexAttribArray(0);
-                  glEnableVertexAttribArray(1);
-                  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GPUVertex), (void*)offsetof(GPUVertex, position));
-                  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GPUVertex), (void*)offsetof(GPUVertex, uvx));
-                  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c->renderChunks[i].ibo);
-                  glDrawElements(GL_TRIANGLES, (GLsizei)c->renderChunks[i].indiceCount, GL_UNSIGNED_INT, (void*)0);
-                  glDisableVertexAttribArray(0);
-                  glDisableVertexAttribArray(1);
-
-                  gVisibleChunks++;
-               }
-            }
+   // Every chunk is drawn with the same quad indices.
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gQuadIBO);
+   glEnableVertexAttribArray(0);
+   glEnableVertexAttribArray(1);
+
+   U32 iterator = 0;
+   Chunk *c;
+   while ((c = (Chunk*)hashMapNext(&gChunkMap, &iterator, NULL)) != NULL) {
+      ChunkGL *gl = &c->gl;
+      if (gl->quadCount == 0)
+         continue;
+
+      gTotalVisibleChunks++;
+
+      // Set position. Vertex positions are local to the chunk.
+      Vec3 pos = create_vec3(c->startX * CHUNK_WIDTH, c->startY * CHUNK_HEIGHT, c->startZ * CHUNK_WIDTH);
+      Vec3 center;
+      Vec3 halfExtents = create_vec3(CHUNK_WIDTH / 2.0f, CHUNK_HEIGHT / 2.0f, CHUNK_WIDTH / 2.0f);
+      glm_vec_add(pos.vec, halfExtents.vec, center.vec);
+
+      if (FrustumCullBox(&frustum, center, halfExtents)) {
+         mat4 modelMatrix;
+         glm_mat4_identity(modelMatrix);
+         glm_translate(modelMatrix, pos.vec);
+         glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &(modelMatrix[0][0]));
+         glBindBuffer(GL_ARRAY_BUFFER, gl->vbo);
+
+         // The indices only reach QUAD_INDEX_MAX_QUADS quads, bigger meshes
+         // are drawn a batch at a time.
+         for (S32 first = 0; first < gl->quadCount; first += QUAD_INDEX_MAX_QUADS) {
+            S32 count = gl->quadCount - first;
+            if (count > QUAD_INDEX_MAX_QUADS)
+               count = QUAD_INDEX_MAX_QUADS;
+            WordSize offset = (WordSize)first * QUAD_VERTEX_COUNT * sizeof(GPUVertex);
+            glVertexAttribPointer(0, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GPUVertex), (void*)(offset + offsetof(GPUVertex, x)));
+            glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GPUVertex), (void*)(offset + offsetof(GPUVertex, u)));
+            glDrawElements(GL_TRIANGLES, (GLsizei)(count * QUAD_INDEX_COUNT), GL_UNSIGNED_SHORT, (void*)0);
          }
+
+         gVisibleChunks++;
       }
    }
 
+   glDisableVertexAttribArray(0);
+   glDisableVertexAttribArray(1);
+
+   // Fill in the terrain past the loaded chunks.
+   Vec3 cameraPos;
+   getCameraPosition(&cameraPos);
+   Vec4 voxelBounds;
+   voxelBounds.x = (F32)((gChunkWindowCenterX - worldSize) * CHUNK_WIDTH);
+   voxelBounds.y = (F32)((gChunkWindowCenterZ - worldSize) * CHUNK_WIDTH);
+   voxelBounds.z = (F32)((gChunkWindowCenterX + worldSize) * CHUNK_WIDTH);
+   voxelBounds.w = (F32)((gChunkWindowCenterZ + worldSize) * CHUNK_WIDTH);
+   F32 voxelMinY = (F32)((gChunkWindowCenterY - worldHeight) * CHUNK_HEIGHT);
+   F32 voxelMaxY = (F32)((gChunkWindowCenterY + worldHeight) * CHUNK_HEIGHT);
+   updateHorizon(cameraPos);
+   renderHorizon(projView, &frustum, voxelBounds, voxelMinY, voxelMaxY);
+
    // Do our raycast to screen world.
    Vec3 rayOrigin;
    Vec4 rayDir;
    screenRayToWorld(view, &rayOrigin, &rayDir);
 
-   // Check to see if we have something within 8 blocks away.
+   // Check to see if we have something within 4 blocks away.
    Vec3 point = rayOrigin;
    Vec3 scalar;
    glm_vec_scale(rayDir.vec, 0.01f, scalar.vec);
+   BlockCursor cursor;
+   initBlockCursor(&cursor, (S32)floorf(point.x), (S32)floorf(point.y), (S32)floorf(point.z));
    for (S32 i = 0; i < 400; ++i) {
       glm_vec_add(point.vec, scalar.vec, point.vec);
 
       Vec3 pos = create_vec3(floorf(point.x), floorf(point.y), floorf(point.z));
+      moveBlockCursor(&cursor, (S32)pos.x, (S32)pos.y, (S32)pos.z);
+
+      // Chunks that are still being generated can't be read yet.
+      if (cursor.chunk != NULL && !cursor.chunk->ready)
+         continue;
+
+      // Jump straight through sections that are entirely air.
+      ChunkSection *section = getBlockCursorSection(&cursor);
+      if (section != NULL && isSectionEmpty(section)) {
+         S32 skip = getRaySectionExitSteps(point, rayDir, 0.01f);
+         Vec3 jump;
+         glm_vec_scale(scalar.vec, (F32)skip, jump.vec);
+         glm_vec_add(point.vec, jump.vec, point.vec);
+         i += skip;
+         continue;
+      }
 
       // Calculate chunk at point.
-      Cube *c = getGlobalCubeAtWorldSpacePosition((S32)pos.x, (S32)pos.y, (S32)pos.z);
-      if (c != NULL && c->material != Material_Air) {
+      Cube c;
+      if (getBlockCursorCube(&cursor, &c) && c.material != Material_Air) {
          glUseProgram(pickerProgram);
 
          glUniformMatrix4fv(pickerShaderProjMatrixLoc, 1, GL_FALSE, &(projView[0][0]));
@@ -853,13 +686,13 @@ void renderWorld(F32 dt) {
          glBindBuffer(GL_ARRAY_BUFFER, singleBufferCubeVBO);
          glEnableVertexAttribArray(0);
          glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(F32) * 4, (void*)0);
-         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, singleBufferCubeIBO);
-         glDrawElements(GL_TRIANGLES, (GLsizei)36, GL_UNSIGNED_INT, (void*)0);
+         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gQuadIBO);
+         glDrawElements(GL_TRIANGLES, (GLsizei)(6 * QUAD_INDEX_COUNT), GL_UNSIGNED_SHORT, (void*)0);
          glDisableVertexAttribArray(0);
 
          // TODO: Have mouse click. For now hit the G key.
          if (pickerStatus == RELEASED && inputGetKeyStatus(KEY_G) == PRESSED) {
-            removeCubeAtWorldPosition(c, (S32)pos.x, (S32)pos.y, (S32)pos.z);
+            removeCubeAtWorldPosition((S32)pos.x, (S32)pos.y, (S32)pos.z);
             pickerStatus = PRESSED;
          } else if (inputGetKeyStatus(KEY_G) == RELEASED) {
             // set picker status to released
@@ -869,4 +702,7 @@ void renderWorld(F32 dt) {
          break;
       }
    }
+
+   // Edits made this frame are remeshed together.
+   flushWorldEdits();
 }
@@ -19,8 +19,23 @@
 
 #include "base/types.h"
 
+/// Sets up the world and queues the chunks around the camera. The chunks
+/// are generated in the background and show up as they finish.
 void initWorld();
 void freeWorld();
+
+/// Blocks until every queued chunk is generated and uploaded. The render
+/// loop never waits; this is for tools that need the whole window at once.
+void finishWorldLoading();
+
+/// Limits how much chunk geometry is uploaded to the GL each frame. Meshes
+/// are built in the background. The ones that don't fit this frame are
+/// uploaded in later frames, and until then the old mesh keeps drawing.
+/// At least one mesh is uploaded per frame.
+/// @param bytesPerFrame The budget in bytes, or 0 to upload every finished
+///        mesh right away.
+void setChunkUploadBudget(U32 bytesPerFrame);
+
 F32 getViewDistance();
 void renderWorld(F32 dt);
 
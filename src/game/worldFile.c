@@ -0,0 +1,243 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "game/worldFile.h"
+
+#define WORLD_FILE_HEADER_SIZE 24
+#define WORLD_FILE_CHUNK_HEADER_SIZE 24
+
+// A chunk never needs more runs than it has cubes, and a run never needs
+// more than the 65535 cubes a chunk can have.
+#define WORLD_FILE_MAX_CHUNK_SIZE (WORLD_FILE_CHUNK_HEADER_SIZE + CHUNK_SIZE * 4)
+
+static inline U8* putU16(U8 *out, U16 value) {
+   out[0] = (U8)value;
+   out[1] = (U8)(value >> 8);
+   return out + 2;
+}
+
+static inline U8* putU32(U8 *out, U32 value) {
+   out = putU16(out, (U16)value);
+   return putU16(out, (U16)(value >> 16));
+}
+
+static inline U8* putU64(U8 *out, U64 value) {
+   out = putU32(out, (U32)value);
+   return putU32(out, (U32)(value >> 32));
+}
+
+static inline U16 getU16(const U8 *in) {
+   return (U16)(in[0] | (in[1] << 8));
+}
+
+static inline U32 getU32(const U8 *in) {
+   return (U32)getU16(in) | ((U32)getU16(in + 2) << 16);
+}
+
+static inline U64 getU64(const U8 *in) {
+   return (U64)getU32(in) | ((U64)getU32(in + 4) << 32);
+}
+
+static inline U64 hashCube(U64 hash, U16 cube) {
+   hash = (hash ^ (cube & 0xFF)) * 1099511628211ULL;
+   return (hash ^ (cube >> 8)) * 1099511628211ULL;
+}
+
+static bool writeWorldFileBytes(WorldFile *worldFile, const U8 *bytes, WordSize size) {
+   if (fwrite(bytes, 1, size, worldFile->file) != size)
+      return false;
+   worldFile->size += size;
+   return true;
+}
+
+bool createWorldFile(WorldFile *worldFile, const char *fileName, U64 seed) {
+   worldFile->file = fopen(fileName, "wb");
+   if (worldFile->file == NULL)
+      return false;
+
+   worldFile->chunkCount = 0;
+   worldFile->size = 0;
+   worldFile->buffer = (U8*)malloc(WORLD_FILE_MAX_CHUNK_SIZE);
+
+   U8 header[WORLD_FILE_HEADER_SIZE] = { 'J', 'C', 'W', 'F' };
+   U8 *out = putU32(header + 4, WORLD_FILE_VERSION);
+   out = putU64(out, seed);
+   out = putU32(out, CHUNK_WIDTH);
+   putU32(out, CHUNK_HEIGHT);
+   return writeWorldFileBytes(worldFile, header, WORLD_FILE_HEADER_SIZE);
+}
+
+bool writeWorldFileChunk(WorldFile *worldFile, Chunk *chunk, U64 *hash) {
+   U8 *runs = worldFile->buffer + WORLD_FILE_CHUNK_HEADER_SIZE;
+   U8 *out = runs;
+   U16 runCube = 0;
+   U32 runLength = 0;
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+         for (S32 y = 0; y < CHUNK_HEIGHT; ++y) {
+            U16 cube = packCube(getCubeAt(chunk, x, y, z));
+            if (runLength > 0 && cube != runCube) {
+               out = putU16(out, (U16)runLength);
+               out = putU16(out, runCube);
+               runLength = 0;
+            }
+            runCube = cube;
+            runLength++;
+         }
+      }
+   }
+   out = putU16(out, (U16)runLength);
+   out = putU16(out, runCube);
+
+   U64 contentHash = getChunkContentHash(chunk);
+   U8 *header = putU32(worldFile->buffer, (U32)chunk->startX);
+   header = putU32(header, (U32)chunk->startY);
+   header = putU32(header, (U32)chunk->startZ);
+   header = putU64(header, contentHash);
+   putU32(header, (U32)((out - runs) / 4));
+
+   *hash = contentHash;
+   worldFile->chunkCount++;
+   return writeWorldFileBytes(worldFile, worldFile->buffer, (WordSize)(out - worldFile->buffer));
+}
+
+bool closeWorldFile(WorldFile *worldFile) {
+   bool ok = fclose(worldFile->file) == 0;
+   free(worldFile->buffer);
+   worldFile->file = NULL;
+   worldFile->buffer = NULL;
+   return ok;
+}
+
+U64 getChunkContentHash(Chunk *chunk) {
+   U64 hash = 14695981039346656037ULL;
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+         for (S32 y = 0; y < CHUNK_HEIGHT; ++y)
+            hash = hashCube(hash, packCube(getCubeAt(chunk, x, y, z)));
+      }
+   }
+   return hash;
+}
+
+// Reads the header of every chunk record, skipping over the runs.
+static void indexWorldFile(WorldFileReader *reader) {
+   U32 capacity = 64;
+   reader->records = (WorldFileRecord*)malloc(sizeof(WorldFileRecord) * capacity);
+   S32 *coordinates = (S32*)malloc(sizeof(S32) * 3 * capacity);
+
+   U8 header[WORLD_FILE_CHUNK_HEADER_SIZE];
+   while (fread(header, 1, WORLD_FILE_CHUNK_HEADER_SIZE, reader->file) == WORLD_FILE_CHUNK_HEADER_SIZE) {
+      WorldFileRecord record;
+      record.offset = ftell(reader->file);
+      record.hash = getU64(header + 12);
+      record.runCount = getU32(header + 20);
+      if (record.runCount == 0 || record.runCount > CHUNK_SIZE || fseek(reader->file, (long)record.runCount * 4, SEEK_CUR) != 0)
+         break;
+
+      if (reader->chunkCount == capacity) {
+         capacity *= 2;
+         reader->records = (WorldFileRecord*)realloc(reader->records, sizeof(WorldFileRecord) * capacity);
+         coordinates = (S32*)realloc(coordinates, sizeof(S32) * 3 * capacity);
+      }
+      reader->records[reader->chunkCount] = record;
+      coordinates[reader->chunkCount * 3] = (S32)getU32(header);
+      coordinates[reader->chunkCount * 3 + 1] = (S32)getU32(header + 4);
+      coordinates[reader->chunkCount * 3 + 2] = (S32)getU32(header + 8);
+      reader->chunkCount++;
+   }
+
+   // The records have stopped moving, so they can be pointed at now.
+   initHashMap(&reader->index, reader->chunkCount);
+   for (U32 i = 0; i < reader->chunkCount; ++i) {
+      const S32 *c = &coordinates[i * 3];
+      hashMapInsert(&reader->index, getChunkKey(c[0], c[1], c[2]), &reader->records[i]);
+   }
+   free(coordinates);
+}
+
+bool openWorldFile(WorldFileReader *reader, const char *fileName, U64 seed) {
+   memset(reader, 0, sizeof(WorldFileReader));
+   reader->file = fopen(fileName, "rb");
+   if (reader->file == NULL)
+      return false;
+
+   U8 header[WORLD_FILE_HEADER_SIZE];
+   if (fread(header, 1, WORLD_FILE_HEADER_SIZE, reader->file) != WORLD_FILE_HEADER_SIZE ||
+       memcmp(header, "JCWF", 4) != 0 || getU32(header + 4) != WORLD_FILE_VERSION || getU64(header + 8) != seed ||
+       getU32(header + 16) != CHUNK_WIDTH || getU32(header + 20) != CHUNK_HEIGHT) {
+      fclose(reader->file);
+      reader->file = NULL;
+      return false;
+   }
+
+   reader->buffer = (U8*)malloc(WORLD_FILE_MAX_CHUNK_SIZE);
+   indexWorldFile(reader);
+   return true;
+}
+
+bool readWorldFileChunk(WorldFileReader *reader, Chunk *chunk) {
+   const WorldFileRecord *record = (const WorldFileRecord*)hashMapGet(&reader->index, getChunkKey(chunk->startX, chunk->startY, chunk->startZ));
+   if (record == NULL)
+      return false;
+
+   WordSize size = (WordSize)record->runCount * 4;
+   if (fseek(reader->file, record->offset, SEEK_SET) != 0 || fread(reader->buffer, 1, size, reader->file) != size)
+      return false;
+
+   // The runs have to cover the chunk exactly.
+   U32 cubeCount = 0;
+   for (U32 i = 0; i < record->runCount; ++i)
+      cubeCount += getU16(reader->buffer + i * 4);
+   if (cubeCount != CHUNK_SIZE)
+      return false;
+
+   initChunkCubes(chunk, Material_Air);
+   const U8 *run = reader->buffer;
+   U32 runLeft = getU16(run);
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+         for (S32 y = 0; y < CHUNK_HEIGHT; ++y) {
+            while (runLeft == 0) {
+               run += 4;
+               runLeft = getU16(run);
+            }
+            Cube cube = unpackCube(getU16(run + 2));
+            if (cube.material != Material_Air)
+               setCubeAt(chunk, x, y, z, (Material)cube.material);
+            runLeft--;
+         }
+      }
+   }
+
+   if (getChunkContentHash(chunk) != record->hash) {
+      freeChunkSection(&chunk->section);
+      return false;
+   }
+   return true;
+}
+
+void closeWorldFileReader(WorldFileReader *reader) {
+   if (reader->file == NULL)
+      return;
+   fclose(reader->file);
+   freeHashMap(&reader->index);
+   free(reader->records);
+   free(reader->buffer);
+   memset(reader, 0, sizeof(WorldFileReader));
+}
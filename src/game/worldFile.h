@@ -0,0 +1,111 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _GAME_WORLDFILE_H_
+#define _GAME_WORLDFILE_H_
+
+#include <stdio.h>
+#include "base/hashMap.h"
+#include "game/chunk.h"
+
+/// A file of generated chunks, written by JeefCraftPregen and read by the
+/// game in place of generating them. Everything is little endian.
+///
+/// Header:
+///    char magic[4]        "JCWF"
+///    U32 version          WORLD_FILE_VERSION
+///    U64 seed             The seed the world was generated with.
+///    U32 chunkWidth       CHUNK_WIDTH
+///    U32 chunkHeight      CHUNK_HEIGHT
+///
+/// Followed by one record per chunk until the end of the file:
+///    S32 x, y, z          Chunk coordinates.
+///    U64 hash             getChunkContentHash of the cubes.
+///    U32 runCount         Number of runs below.
+///    runs[runCount]       U16 length, U16 cube (see packCube).
+///
+/// The runs cover the cubes in x, z, y order, y changing fastest, whatever
+/// the in-memory chunk layout is.
+#define WORLD_FILE_VERSION 1
+
+typedef struct WorldFile {
+   FILE *file;
+   U32 chunkCount;   /// Number of chunks written so far.
+   WordSize size;    /// Number of bytes written so far.
+   U8 *buffer;       /// Scratch space for encoding a chunk.
+} WorldFile;
+
+/// Creates a world file and writes its header.
+/// @param worldFile The world file to set up.
+/// @param fileName The file to create. It is overwritten if it exists.
+/// @param seed The seed the chunks are generated with.
+/// @return false if the file couldn't be created.
+bool createWorldFile(WorldFile *worldFile, const char *fileName, U64 seed);
+
+/// Appends a generated chunk.
+/// @param worldFile The world file to write to.
+/// @param chunk The chunk to write.
+/// @param hash Set to getChunkContentHash of the chunk.
+/// @return false if the chunk couldn't be written.
+bool writeWorldFileChunk(WorldFile *worldFile, Chunk *chunk, U64 *hash);
+
+/// Closes a world file.
+/// @return false if anything couldn't be written.
+bool closeWorldFile(WorldFile *worldFile);
+
+/// Where a chunk's runs are in a world file being read.
+typedef struct WorldFileRecord {
+   long offset;      /// File offset of the first run.
+   U32 runCount;
+   U64 hash;         /// getChunkContentHash of the cubes.
+} WorldFileRecord;
+
+typedef struct WorldFileReader {
+   FILE *file;
+   WorldFileRecord *records;
+   U32 chunkCount;   /// Number of chunks in the file.
+   HashMap index;    /// getChunkKey to the chunk's record.
+   U8 *buffer;       /// Scratch space for decoding a chunk.
+} WorldFileReader;
+
+/// Opens a world file and indexes its chunks. A file that was cut short
+/// keeps the chunks before the cut.
+/// @param reader The reader to set up.
+/// @param fileName The file to read.
+/// @param seed The seed the game generates the world with.
+/// @return false if the file can't be read or was written for another seed,
+///         version or chunk size.
+bool openWorldFile(WorldFileReader *reader, const char *fileName, U64 seed);
+
+/// Fills a chunk with its cubes from the world file, trees and all. Its
+/// status is left for the caller to set.
+/// @param reader The world file to read from.
+/// @param chunk The chunk to fill, with its coordinates set and no cubes.
+/// @return false if the file doesn't have the chunk or its record is
+///         damaged. The chunk then still has no cubes.
+bool readWorldFileChunk(WorldFileReader *reader, Chunk *chunk);
+
+/// Closes a world file opened with openWorldFile.
+void closeWorldFileReader(WorldFileReader *reader);
+
+/// Hashes the cubes of a chunk in world file order. Two chunks only have the
+/// same hash if they very likely hold the same cubes, whatever chunk layout
+/// the game was built with.
+/// @param chunk The chunk to hash.
+/// @return A 64-bit FNV-1a hash of the cubes.
+U64 getChunkContentHash(Chunk *chunk);
+
+#endif
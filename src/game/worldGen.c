@@ -0,0 +1,647 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <string.h>
+#include <open-simplex-noise.h>
+#include "game/blockCursor.h"
+#include "game/worldGen.h"
+#include "base/pool.h"
+#include "math/noise.h"
+#include "platform/thread.h"
+
+/// Everything below this height is bedrock.
+#define BEDROCK_HEIGHT 4
+
+/// Trees have a 3 cube trunk with a layer of leaves on top that reaches 3
+/// cubes before the trunk and 2 cubes after it. TREE_ROOT_APRON_BEFORE and
+/// TREE_ROOT_APRON_AFTER in chunk.h have to match.
+#define TREE_HEIGHT 4
+
+/// Spacing of the lattice the cave noise is sampled on, see
+/// setCaveLatticeStep. 1 samples every cube.
+#ifndef CAVE_LATTICE_STEP
+#define CAVE_LATTICE_STEP 1
+#endif
+
+/// Cubes above this noise value are carved out.
+#define CAVE_THRESHOLD 1.33
+
+/// Most lattice points along an axis of n cubes and the volume border. The
+/// smallest coarse step is 2.
+#define CAVE_LATTICE_POINTS(n) ((n) / 2 + 3)
+
+/// The cave density volume covers a chunk and a 1 cube border around it.
+#define CAVE_VOLUME_WIDTH (CHUNK_WIDTH + 2)
+#define CAVE_VOLUME_HEIGHT (CHUNK_HEIGHT + 2)
+#define CAVE_VOLUME_SIZE (CAVE_VOLUME_WIDTH * CAVE_VOLUME_WIDTH * CAVE_VOLUME_HEIGHT)
+
+/// Entries of the cave density volume. The noise is only sampled the first
+/// time a cube is asked about.
+typedef enum CaveDensity {
+   CaveDensity_Unknown,
+   CaveDensity_Solid,
+   CaveDensity_Cave
+} CaveDensity;
+
+static Noise gNoise;
+
+static S32 gCaveLatticeStep = CAVE_LATTICE_STEP;
+
+static Pool gCaveDensityPool;
+static Mutex *gCaveDensityMutex = NULL;
+
+void initWorldGen(U64 seed) {
+   initNoise(&gNoise, (S64)seed);
+   gCaveDensityMutex = createMutex();
+   initPool(&gCaveDensityPool, CAVE_VOLUME_SIZE, 64);
+}
+
+void freeWorldGen() {
+   freeNoise(&gNoise);
+   freePool(&gCaveDensityPool);
+   freeMutex(gCaveDensityMutex);
+   gCaveDensityMutex = NULL;
+}
+
+void setCaveLatticeStep(S32 step) {
+   gCaveLatticeStep = step < 1 ? 1 : step;
+}
+
+S32 getCaveLatticeStep() {
+   return gCaveLatticeStep;
+}
+
+void freeCaveDensity(Chunk *chunk) {
+   if (chunk->caveDensity == NULL)
+      return;
+   lockMutex(gCaveDensityMutex);
+   poolFree(&gCaveDensityPool, chunk->caveDensity);
+   unlockMutex(gCaveDensityMutex);
+   chunk->caveDensity = NULL;
+}
+
+#define CAVE_OCTAVES 6
+
+/// Most cubes of a run whose octaves fit in one noise batch.
+#define CAVE_RUN_MAX (NOISE_BATCH_MAX / CAVE_OCTAVES)
+
+// Worldspace. Samples count cubes going up from y, stepY apart, with the
+// octaves of all of them in one batch.
+static void getCaveNoiseRun(S32 x, S32 y, S32 z, S32 stepY, S32 count, F64 *noise) {
+   F64 cave_stretch = 24.0;
+
+   F64 sampleX[NOISE_BATCH_MAX];
+   F64 sampleY[NOISE_BATCH_MAX];
+   F64 sampleZ[NOISE_BATCH_MAX];
+   F64 samples[NOISE_BATCH_MAX];
+   for (S32 first = 0; first < count; first += CAVE_RUN_MAX) {
+      S32 runCount = count - first < CAVE_RUN_MAX ? count - first : CAVE_RUN_MAX;
+      for (S32 i = 0; i < CAVE_OCTAVES; ++i) {
+         F64 factor = cave_stretch * ((F64)((1 << i) / 3) + 1.0);
+         for (S32 n = 0; n < runCount; ++n) {
+            S32 sample = n * CAVE_OCTAVES + i;
+            sampleX[sample] = (F64)(x) / factor * (F64)(1 << i);
+            sampleY[sample] = (F64)(y + (first + n) * stepY) / factor * (F64)(1 << (i + 1));
+            sampleZ[sample] = (F64)(z) / factor * (F64)(1 << i);
+         }
+      }
+      sampleNoise3Batch(&gNoise, sampleX, sampleY, sampleZ, samples, runCount * CAVE_OCTAVES);
+
+      for (S32 n = 0; n < runCount; ++n) {
+         F64 sum = 0.0;
+         for (S32 i = 0; i < CAVE_OCTAVES; ++i)
+            sum += (samples[n * CAVE_OCTAVES + i] + 1.0) / (F64)(1 << (i + 1));
+         noise[first + n] = sum;
+      }
+   }
+}
+
+// Worldspace
+static F64 getCaveNoise(S32 x, S32 y, S32 z) {
+   F64 noise;
+   getCaveNoiseRun(x, y, z, 1, 1, &noise);
+   return noise;
+}
+
+// Local coordinates, -1 to CHUNK_WIDTH / CHUNK_HEIGHT inclusive.
+static inline S32 getCaveDensityIndex(S32 x, S32 y, S32 z) {
+   return ((x + 1) * CAVE_VOLUME_WIDTH + (z + 1)) * CAVE_VOLUME_HEIGHT + (y + 1);
+}
+
+// The border of the volume is the edge of a neighbouring chunk. If that
+// chunk has already been carved its volume won't change any more, so
+// whatever it sampled can be reused. Only face neighbours are ever asked
+// about, so exactly one coordinate is outside of the chunk.
+static CaveDensity getNeighbourCaveDensity(const Chunk *chunk, S32 x, S32 y, S32 z) {
+   const Chunk *neighbour;
+   if (x < 0) {
+      neighbour = chunk->neighbours[ChunkNeighbour_NegativeX];
+      x += CHUNK_WIDTH;
+   } else if (x >= CHUNK_WIDTH) {
+      neighbour = chunk->neighbours[ChunkNeighbour_PositiveX];
+      x -= CHUNK_WIDTH;
+   } else if (y < 0) {
+      neighbour = chunk->neighbours[ChunkNeighbour_NegativeY];
+      y += CHUNK_HEIGHT;
+   } else if (y >= CHUNK_HEIGHT) {
+      neighbour = chunk->neighbours[ChunkNeighbour_PositiveY];
+      y -= CHUNK_HEIGHT;
+   } else if (z < 0) {
+      neighbour = chunk->neighbours[ChunkNeighbour_NegativeZ];
+      z += CHUNK_WIDTH;
+   } else if (z >= CHUNK_WIDTH) {
+      neighbour = chunk->neighbours[ChunkNeighbour_PositiveZ];
+      z -= CHUNK_WIDTH;
+   } else {
+      return CaveDensity_Unknown;
+   }
+
+   if (neighbour == NULL || neighbour->caveDensity == NULL || neighbour->status < ChunkStatus_Carved)
+      return CaveDensity_Unknown;
+   return (CaveDensity)neighbour->caveDensity[getCaveDensityIndex(x, y, z)];
+}
+
+// Trilinearly interpolates between the 8 lattice points around a cube,
+// named x, z, y. Everything that samples the lattice goes through here so
+// that every cube gets exactly the same value.
+static inline F32 interpolateCaveLattice(F32 c000, F32 c100, F32 c010, F32 c110, F32 c001, F32 c101, F32 c011, F32 c111, F32 tx, F32 ty, F32 tz) {
+   F32 x00 = c000 + (c100 - c000) * tx;
+   F32 x01 = c010 + (c110 - c010) * tx;
+   F32 x10 = c001 + (c101 - c001) * tx;
+   F32 x11 = c011 + (c111 - c011) * tx;
+   F32 lower = x00 + (x01 - x00) * tz;
+   F32 upper = x10 + (x11 - x10) * tz;
+   return lower + (upper - lower) * ty;
+}
+
+// Worldspace. Whether a single cube is inside of a cave, without needing
+// its chunk. Agrees with the density volume of whichever chunk the cube is
+// in, whatever the lattice step.
+static bool isCaveCube(S32 x, S32 y, S32 z) {
+   S32 step = gCaveLatticeStep;
+   if (step == 1)
+      return getCaveNoise(x, y, z) >= CAVE_THRESHOLD;
+
+   S32 x0 = getChunkCoordinate(x, step) * step;
+   S32 y0 = getChunkCoordinate(y, step) * step;
+   S32 z0 = getChunkCoordinate(z, step) * step;
+   F32 invStep = 1.0f / (F32)step;
+   F32 noise = interpolateCaveLattice(
+      (F32)getCaveNoise(x0, y0, z0), (F32)getCaveNoise(x0 + step, y0, z0),
+      (F32)getCaveNoise(x0, y0, z0 + step), (F32)getCaveNoise(x0 + step, y0, z0 + step),
+      (F32)getCaveNoise(x0, y0 + step, z0), (F32)getCaveNoise(x0 + step, y0 + step, z0),
+      (F32)getCaveNoise(x0, y0 + step, z0 + step), (F32)getCaveNoise(x0 + step, y0 + step, z0 + step),
+      (F32)(x - x0) * invStep, (F32)(y - y0) * invStep, (F32)(z - z0) * invStep);
+   return noise >= CAVE_THRESHOLD;
+}
+
+// Fills the whole density volume by sampling the noise on a coarse lattice
+// and interpolating between the lattice points. The lattice is aligned to
+// world space, so neighbouring chunks agree on the cubes they share.
+static void fillCaveDensityFromLattice(Chunk *chunk) {
+   S32 step = gCaveLatticeStep;
+
+   // World position of the first cube of the volume and the lattice point
+   // at or below it.
+   S32 worldX = chunk->startX * CHUNK_WIDTH - 1;
+   S32 worldY = chunk->startY * CHUNK_HEIGHT - 1;
+   S32 worldZ = chunk->startZ * CHUNK_WIDTH - 1;
+   S32 latticeX = getChunkCoordinate(worldX, step) * step;
+   S32 latticeY = getChunkCoordinate(worldY, step) * step;
+   S32 latticeZ = getChunkCoordinate(worldZ, step) * step;
+   S32 countX = (worldX + CAVE_VOLUME_WIDTH - 1 - latticeX + step - 1) / step + 1;
+   S32 countY = (worldY + CAVE_VOLUME_HEIGHT - 1 - latticeY + step - 1) / step + 1;
+   S32 countZ = (worldZ + CAVE_VOLUME_WIDTH - 1 - latticeZ + step - 1) / step + 1;
+
+   F32 lattice[CAVE_LATTICE_POINTS(CHUNK_WIDTH) * CAVE_LATTICE_POINTS(CHUNK_WIDTH) * CAVE_LATTICE_POINTS(CHUNK_HEIGHT)];
+   for (S32 i = 0; i < countX; ++i) {
+      for (S32 k = 0; k < countZ; ++k) {
+         F64 noise[CAVE_LATTICE_POINTS(CHUNK_HEIGHT)];
+         getCaveNoiseRun(latticeX + i * step, latticeY, latticeZ + k * step, step, countY, noise);
+         for (S32 j = 0; j < countY; ++j)
+            lattice[(i * countZ + k) * countY + j] = (F32)noise[j];
+      }
+   }
+
+   F32 invStep = 1.0f / (F32)step;
+   for (S32 x = 0; x < CAVE_VOLUME_WIDTH; ++x) {
+      S32 i0 = (worldX + x - latticeX) / step;
+      S32 i1 = i0 + 1 < countX ? i0 + 1 : i0;
+      F32 tx = (F32)(worldX + x - latticeX - i0 * step) * invStep;
+      for (S32 z = 0; z < CAVE_VOLUME_WIDTH; ++z) {
+         S32 k0 = (worldZ + z - latticeZ) / step;
+         S32 k1 = k0 + 1 < countZ ? k0 + 1 : k0;
+         F32 tz = (F32)(worldZ + z - latticeZ - k0 * step) * invStep;
+         const F32 *c00 = &lattice[(i0 * countZ + k0) * countY];
+         const F32 *c01 = &lattice[(i0 * countZ + k1) * countY];
+         const F32 *c10 = &lattice[(i1 * countZ + k0) * countY];
+         const F32 *c11 = &lattice[(i1 * countZ + k1) * countY];
+         U8 *density = &chunk->caveDensity[getCaveDensityIndex(x - 1, -1, z - 1)];
+         for (S32 y = 0; y < CAVE_VOLUME_HEIGHT; ++y) {
+            S32 j0 = (worldY + y - latticeY) / step;
+            S32 j1 = j0 + 1 < countY ? j0 + 1 : j0;
+            F32 ty = (F32)(worldY + y - latticeY - j0 * step) * invStep;
+
+            F32 noise = interpolateCaveLattice(c00[j0], c10[j0], c01[j0], c11[j0], c00[j1], c10[j1], c01[j1], c11[j1], tx, ty, tz);
+            density[y] = (U8)(noise >= CAVE_THRESHOLD ? CaveDensity_Cave : CaveDensity_Solid);
+         }
+      }
+   }
+}
+
+// Local coordinates. Samples the cave noise at most once per cube.
+static bool isCaveAt(Chunk *chunk, S32 x, S32 y, S32 z) {
+   U8 *density = &chunk->caveDensity[getCaveDensityIndex(x, y, z)];
+   if (*density == CaveDensity_Unknown) {
+      if (gCaveLatticeStep > 1) {
+         fillCaveDensityFromLattice(chunk);
+      } else {
+         CaveDensity shared = getNeighbourCaveDensity(chunk, x, y, z);
+         if (shared == CaveDensity_Unknown) {
+            F64 noise = getCaveNoise(chunk->startX * CHUNK_WIDTH + x, chunk->startY * CHUNK_HEIGHT + y, chunk->startZ * CHUNK_WIDTH + z);
+            shared = noise >= CAVE_THRESHOLD ? CaveDensity_Cave : CaveDensity_Solid;
+         }
+         *density = (U8)shared;
+      }
+   }
+   return *density == CaveDensity_Cave;
+}
+
+// Local coordinates. Samples the cubes of a column from 0 to height that
+// carving will ask about in runs, so that isCaveAt finds them known. Only
+// for a lattice step of 1, the lattice fills the whole volume at once.
+static void fillCaveDensityColumn(Chunk *chunk, S32 x, S32 z, S32 height) {
+   S32 worldX = chunk->startX * CHUNK_WIDTH + x;
+   S32 worldY = chunk->startY * CHUNK_HEIGHT;
+   S32 worldZ = chunk->startZ * CHUNK_WIDTH + z;
+   U8 *density = &chunk->caveDensity[getCaveDensityIndex(x, 0, z)];
+
+   S32 y = 0;
+   while (y <= height) {
+      // A run is the unknown cubes up to the next bedrock or known cube.
+      S32 count = 0;
+      while (y + count <= height && count < CAVE_RUN_MAX && density[y + count] == CaveDensity_Unknown &&
+             getCubeAt(chunk, x, y + count, z).material != Material_Bedrock)
+         ++count;
+      if (count == 0) {
+         ++y;
+         continue;
+      }
+
+      F64 noise[CAVE_RUN_MAX];
+      getCaveNoiseRun(worldX, worldY + y, worldZ, 1, count, noise);
+      for (S32 n = 0; n < count; ++n)
+         density[y + n] = (U8)(noise[n] >= CAVE_THRESHOLD ? CaveDensity_Cave : CaveDensity_Solid);
+      y += count;
+   }
+}
+
+// The material of the base terrain at world height y of a column whose
+// surface is at height. There is nothing below the bedrock.
+static inline Material getTerrainMaterial(S32 y, S32 height) {
+   if (y < 0)
+      return Material_Air;
+   if (y < BEDROCK_HEIGHT)
+      return Material_Bedrock;
+   if (y > height)
+      return Material_Air;
+   if (y == height)
+      return Material_Grass;
+   return Material_Dirt;
+}
+
+/// Terrain heights of the columns along the 4 sides of a chunk being
+/// carved, -x, +x, -z and +z. Sampled the first time carving asks.
+typedef struct CaveBorder {
+   S16 heights[4][CHUNK_WIDTH];
+} CaveBorder;
+
+#define CAVE_BORDER_UNKNOWN -32768
+
+static void initCaveBorder(CaveBorder *border) {
+   for (S32 side = 0; side < 4; ++side) {
+      for (S32 i = 0; i < CHUNK_WIDTH; ++i)
+         border->heights[side][i] = CAVE_BORDER_UNKNOWN;
+   }
+}
+
+// Whether the base terrain is solid under a cursor outside of the chunk
+// being carved. Only the seed decides, not what is loaded next to the chunk
+// or how far along it is, so carving doesn't depend on the load order. The
+// columns around the chunk may not have their heights yet, a chunk read
+// from a world file doesn't need them, so they are sampled here.
+static bool isTerrainSolidAt(const Chunk *chunk, CaveBorder *border, const BlockCursor *cursor) {
+   S32 height;
+   if (cursor->chunkX == chunk->startX && cursor->chunkZ == chunk->startZ) {
+      height = chunk->column->terrainHeight[getColumnIndex(cursor->x, cursor->z)];
+   } else {
+      S16 *borderHeight;
+      if (cursor->chunkX != chunk->startX)
+         borderHeight = &border->heights[cursor->chunkX < chunk->startX ? 0 : 1][cursor->z];
+      else
+         borderHeight = &border->heights[cursor->chunkZ < chunk->startZ ? 2 : 3][cursor->x];
+      if (*borderHeight == CAVE_BORDER_UNKNOWN)
+         *borderHeight = (S16)getTerrainHeight(getBlockCursorWorldX(cursor), getBlockCursorWorldZ(cursor));
+      height = *borderHeight;
+   }
+   return getTerrainMaterial(getBlockCursorWorldY(cursor), height) != Material_Air;
+}
+
+// A neighbour only counts as solid if it won't be carved out itself.
+static inline bool isSolidAfterCaving(Chunk *chunk, CaveBorder *border, const BlockCursor *neighbour, S32 x, S32 y, S32 z) {
+   bool solid = neighbour->chunk == chunk ? !isBlockCursorTransparent(neighbour) : isTerrainSolidAt(chunk, border, neighbour);
+   return solid && !isCaveAt(chunk, x, y, z);
+}
+
+static S32 solidCubesAroundCubeAt(Chunk *chunk, CaveBorder *border, S32 x, S32 y, S32 z) {
+   S32 solidCount = 0;
+   BlockCursor cursor;
+   BlockCursor neighbour;
+   initBlockCursorInChunk(&cursor, chunk, x, y, z);
+
+   neighbour = cursor;
+   stepXNeg(&neighbour);
+   solidCount += isSolidAfterCaving(chunk, border, &neighbour, x - 1, y, z);
+
+   neighbour = cursor;
+   stepXPos(&neighbour);
+   solidCount += isSolidAfterCaving(chunk, border, &neighbour, x + 1, y, z);
+
+   neighbour = cursor;
+   stepYNeg(&neighbour);
+   solidCount += isSolidAfterCaving(chunk, border, &neighbour, x, y - 1, z);
+
+   neighbour = cursor;
+   stepYPos(&neighbour);
+   solidCount += isSolidAfterCaving(chunk, border, &neighbour, x, y + 1, z);
+
+   neighbour = cursor;
+   stepZNeg(&neighbour);
+   solidCount += isSolidAfterCaving(chunk, border, &neighbour, x, y, z - 1);
+
+   neighbour = cursor;
+   stepZPos(&neighbour);
+   solidCount += isSolidAfterCaving(chunk, border, &neighbour, x, y, z + 1);
+
+   return solidCount;
+}
+
+#define TERRAIN_STRETCH 20.0
+
+/// Bound on the magnitude of open_simplex_noise2. Each of the 4 lattice
+/// points adds at most |gradient| * max((2 - r^2)^4 * r) = 5.39 * 4.71, and
+/// the sum is divided by 47.
+#define TERRAIN_NOISE_BOUND 2.2
+
+/// The smoothing filter divides by 10 after every row, so only the last
+/// rows really decide the height. Rows from here on are always sampled.
+#define TERRAIN_EXACT_FIRST_ROW 2
+
+#define TERRAIN_FILTER_ROWS 10
+#define TERRAIN_FILTER_COLUMNS 10
+
+// Samples row i of the smoothing filter of column x, z in one batch.
+static void sampleTerrainRow(S32 x, S32 z, S32 i, F64 samples[TERRAIN_FILTER_COLUMNS]) {
+   F64 sampleX[TERRAIN_FILTER_COLUMNS];
+   F64 sampleZ[TERRAIN_FILTER_COLUMNS];
+   for (S32 j = -5; j < 5; ++j) {
+      sampleX[j + 5] = (F64)(x + i) / (TERRAIN_STRETCH + i);
+      sampleZ[j + 5] = (F64)(z + j) / (TERRAIN_STRETCH + j);
+   }
+   sampleNoise2Batch(&gNoise, sampleX, sampleZ, samples, TERRAIN_FILTER_COLUMNS);
+}
+
+// Runs the smoothing filter the way it was written, in the same order so
+// that the result is bit for bit the same. Samples of the rows from
+// TERRAIN_EXACT_FIRST_ROW on are passed in, the rest are taken here.
+static S32 filterTerrainHeight(S32 x, S32 z, F64 knownSamples[][TERRAIN_FILTER_COLUMNS]) {
+   // calculate height for each cube.
+   // Taking absolute value will allow for only 0-1 scaling.
+   // also make sure to use the world coordinates
+
+   // Smoothen the noise based on 5 blocks surrounding it.
+   F64 noise = (open_simplex_noise2(gNoise.context, (F64)x / TERRAIN_STRETCH, (F64)z / TERRAIN_STRETCH)) * 10.0;
+   for (S32 i = -5; i < 5; ++i) {
+      F64 rowSamples[TERRAIN_FILTER_COLUMNS];
+      const F64 *row = rowSamples;
+      if (knownSamples != NULL && i >= TERRAIN_EXACT_FIRST_ROW)
+         row = knownSamples[i - TERRAIN_EXACT_FIRST_ROW];
+      else
+         sampleTerrainRow(x, z, i, rowSamples);
+
+      for (S32 j = -5; j < 5; ++j)
+         noise += (row[j + 5] * (10.0 + j)) / 2.0f;
+      noise /= 10.f;
+   }
+   //F64 noise = fabs(open_simplex_noise2(gNoise.context, (F64)(x + worldX) / stretchFactor, (F64)(z + worldZ) / stretchFactor) * 10.0);
+   return (S32)((S32)(noise) + 70.0f); // 70 as base height.
+}
+
+S32 getTerrainHeightReference(S32 x, S32 z) {
+   return filterTerrainHeight(x, z, NULL);
+}
+
+S32 getTerrainHeight(S32 x, S32 z) {
+   // Sum up the rows that matter. Every row before them is worth at most
+   // 47.5 * TERRAIN_NOISE_BOUND and is divided by 10 at least once more for
+   // each row in between.
+   F64 samples[TERRAIN_FILTER_ROWS - 5 - TERRAIN_EXACT_FIRST_ROW][TERRAIN_FILTER_COLUMNS];
+   F64 partial = 0.0;
+   F64 scale = 1.0;
+   for (S32 i = 4; i >= TERRAIN_EXACT_FIRST_ROW; --i) {
+      scale /= 10.0;
+      F64 *rowSamples = samples[i - TERRAIN_EXACT_FIRST_ROW];
+      sampleTerrainRow(x, z, i, rowSamples);
+
+      F64 row = 0.0;
+      for (S32 j = -5; j < 5; ++j)
+         row += rowSamples[j + 5] * (10.0 + j) / 2.0;
+      partial += row * scale;
+   }
+   F64 unknown = 47.5 * TERRAIN_NOISE_BOUND / 9.0 * scale + 1.0e-5;
+
+   // Only when the rest could push the height over a whole number do we
+   // need to sample them too.
+   S32 low = (S32)(partial - unknown);
+   S32 high = (S32)(partial + unknown);
+   if (low == high)
+      return (S32)(low + 70.0f);
+   return filterTerrainHeight(x, z, samples);
+}
+
+void generateColumnTerrain(ChunkColumn *column) {
+   S32 worldX = column->x * CHUNK_WIDTH;
+   S32 worldZ = column->z * CHUNK_WIDTH;
+
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z)
+         column->terrainHeight[getColumnIndex(x, z)] = (S16)getTerrainHeight(x + worldX, z + worldZ);
+   }
+
+   // Find every tree that can grow into this column, including the ones
+   // rooted in the columns around it. Where a tree grows only depends on
+   // the noise, so every column agrees on it whatever is loaded.
+   column->treeRootCount = 0;
+   for (S32 x = -TREE_ROOT_APRON_BEFORE; x < CHUNK_WIDTH + TREE_ROOT_APRON_AFTER; ++x) {
+      for (S32 z = -TREE_ROOT_APRON_BEFORE; z < CHUNK_WIDTH + TREE_ROOT_APRON_AFTER; ++z) {
+         // Trees grow on grass, 1 in 10 of the time.
+         if (open_simplex_noise2(gNoise.context, (F64)x + worldX, (F64)z + worldZ) < 0.8)
+            continue;
+
+         S32 height;
+         if (x >= 0 && x < CHUNK_WIDTH && z >= 0 && z < CHUNK_WIDTH)
+            height = column->terrainHeight[getColumnIndex(x, z)];
+         else
+            height = getTerrainHeight(x + worldX, z + worldZ);
+         if (getTerrainMaterial(height, height) != Material_Grass)
+            continue;
+
+         // Don't grow over a cave that opens up at the surface. Cave
+         // smoothing can only keep cubes, so this is never wrong the other
+         // way around.
+         if (isCaveCube(x + worldX, height, z + worldZ))
+            continue;
+
+         TreeRoot *root = &column->treeRoots[column->treeRootCount++];
+         root->x = (S16)x;
+         root->y = (S16)height;
+         root->z = (S16)z;
+      }
+   }
+
+   column->hasTerrain = true;
+}
+
+void generateWorld(Chunk *chunk) {
+   ChunkColumn *column = chunk->column;
+   if (!column->hasTerrain)
+      generateColumnTerrain(column);
+
+   S32 minHeight = column->terrainHeight[0];
+   S32 maxHeight = column->terrainHeight[0];
+   for (S32 i = 1; i < CHUNK_WIDTH * CHUNK_WIDTH; ++i) {
+      if (column->terrainHeight[i] < minHeight)
+         minHeight = column->terrainHeight[i];
+      if (column->terrainHeight[i] > maxHeight)
+         maxHeight = column->terrainHeight[i];
+   }
+
+   // Most chunks are entirely sky or entirely underground. Those are a
+   // single uniform section.
+   S32 baseY = chunk->startY * CHUNK_HEIGHT;
+   if ((baseY > maxHeight && baseY >= BEDROCK_HEIGHT) || baseY + CHUNK_HEIGHT <= 0) {
+      initChunkCubes(chunk, Material_Air);
+      return;
+   }
+   if (baseY >= BEDROCK_HEIGHT && baseY + CHUNK_HEIGHT <= minHeight) {
+      initChunkCubes(chunk, Material_Dirt);
+      return;
+   }
+
+   initChunkCubes(chunk, Material_Air);
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+         S32 height = column->terrainHeight[getColumnIndex(x, z)];
+         for (S32 y = 0; y < CHUNK_HEIGHT; ++y) {
+            Material material = getTerrainMaterial(baseY + y, height);
+            if (material != Material_Air)
+               setCubeAt(chunk, x, y, z, material);
+         }
+      }
+   }
+}
+
+void generateCaves(Chunk *chunk) {
+   if (chunk->caveDensity == NULL) {
+      lockMutex(gCaveDensityMutex);
+      chunk->caveDensity = (U8*)poolAlloc(&gCaveDensityPool);
+      unlockMutex(gCaveDensityMutex);
+   }
+   memset(chunk->caveDensity, CaveDensity_Unknown, CAVE_VOLUME_SIZE);
+   CaveBorder border;
+   initCaveBorder(&border);
+
+   for (S32 x = 0; x < CHUNK_WIDTH; ++x) {
+      for (S32 z = 0; z < CHUNK_WIDTH; ++z) {
+         // Only the terrain below the surface can be carved. Carving can
+         // lower the heightmap so grab the height up front.
+         S32 height = getColumnHeight(chunk, x, z);
+         if (gCaveLatticeStep == 1)
+            fillCaveDensityColumn(chunk, x, z, height);
+         for (S32 y = 0; y <= height; ++y) {
+            Cube c = getCubeAt(chunk, x, y, z);
+            if (c.material == Material_Bedrock)
+               continue;
+
+            if (isCaveAt(chunk, x, y, z)) {
+               // Perform smothing.
+               S32 solidCount = solidCubesAroundCubeAt(chunk, &border, x, y, z);
+               if (solidCount < 4) {
+                  // It's a cave, carve out air.
+                  setCubeAt(chunk, x, y, z, Material_Air);
+               }
+            }
+         }
+      }
+   }
+}
+
+// Trunks win over leaves, and trees win over the terrain.
+static inline S32 getStructurePriority(Material material) {
+   switch (material) {
+      case Material_Wood_Trunk:
+         return 2;
+      case Material_Leaves:
+         return 1;
+      default:
+         return 0;
+   }
+}
+
+// Local coordinates. Parts of trees that are outside of the chunk are
+// clipped off, the chunk they are in grows them itself.
+static void setStructureCube(Chunk *chunk, S32 x, S32 y, S32 z, Material material) {
+   if (x < 0 || x >= CHUNK_WIDTH || y < 0 || y >= CHUNK_HEIGHT || z < 0 || z >= CHUNK_WIDTH)
+      return;
+   if (getStructurePriority((Material)getCubeAt(chunk, x, y, z).material) <= getStructurePriority(material))
+      setCubeAt(chunk, x, y, z, material);
+}
+
+void generateStructures(Chunk *chunk) {
+   // Every neighbour has been carved by now, so nothing will read the cave
+   // density of this chunk again.
+   freeCaveDensity(chunk);
+
+   // Lets generate some trees.
+   const ChunkColumn *column = chunk->column;
+   S32 baseY = chunk->startY * CHUNK_HEIGHT;
+   for (U32 i = 0; i < column->treeRootCount; ++i) {
+      const TreeRoot *root = &column->treeRoots[i];
+      S32 x = root->x;
+      S32 z = root->z;
+      S32 height = root->y - baseY;
+      if (height + TREE_HEIGHT < 0 || height + 1 >= CHUNK_HEIGHT)
+         continue;
+
+      setStructureCube(chunk, x, height + 1, z, Material_Wood_Trunk);
+      setStructureCube(chunk, x, height + 2, z, Material_Wood_Trunk);
+      setStructureCube(chunk, x, height + 3, z, Material_Wood_Trunk);
+      for (S32 xxx = x - 3; xxx < x + 3; ++xxx) {
+         for (S32 zzz = z - 3; zzz < z + 3; ++zzz)
+            setStructureCube(chunk, xxx, height + 4, zzz, Material_Leaves);
+      }
+   }
+}
@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _GAME_WORLDGEN_H_
+#define _GAME_WORLDGEN_H_
+
+#include "game/chunk.h"
+
+/// Creates the noise generators used to build the world.
+/// @param seed The world seed.
+void initWorldGen(U64 seed);
+
+/// Frees the noise generators.
+void freeWorldGen();
+
+/// @return The world y of the surface at world position x, z.
+S32 getTerrainHeight(S32 x, S32 z);
+
+/// Same as getTerrainHeight, but runs the whole smoothing filter instead of
+/// skipping the rows that can't change the result. Slow, for checking
+/// getTerrainHeight against.
+S32 getTerrainHeightReference(S32 x, S32 z);
+
+/// Generates the surface height of every x, z position in a column and
+/// finds the trees that grow into it. generateWorld does this on its own if
+/// it hasn't been done yet.
+/// @param column The column to generate.
+void generateColumnTerrain(ChunkColumn *column);
+
+/// Fills a chunk with its base terrain: bedrock, dirt, a grass surface and
+/// air above it. The chunk must already be in gChunkMap.
+/// @param chunk The chunk to generate.
+void generateWorld(Chunk *chunk);
+
+/// Carves caves out of a chunk that already has its terrain. Neighbouring
+/// chunks are read while smoothing the caves.
+///
+/// The cave noise of the chunk is cached in chunk->caveDensity, which is
+/// kept until generateStructures so that neighbours carved later can reuse
+/// the cubes along the shared face. Neighbours are only reused once their
+/// status is at least ChunkStatus_Carved.
+/// @param chunk The chunk to carve.
+void generateCaves(Chunk *chunk);
+
+/// Sets the spacing of the lattice the cave noise is sampled on. With a step
+/// above 1 the noise is only sampled every step cubes and interpolated in
+/// between, which is a lot faster but doesn't carve exactly the same caves.
+/// The default is CAVE_LATTICE_STEP, 1 unless set at build time. Must not be
+/// changed while chunks are being generated.
+/// @param step The lattice spacing in cubes. 1 samples every cube.
+void setCaveLatticeStep(S32 step);
+
+/// @return The spacing of the cave noise lattice, see setCaveLatticeStep.
+S32 getCaveLatticeStep();
+
+/// Frees the cave noise cached by generateCaves, if any.
+/// @param chunk The chunk that is no longer being generated.
+void freeCaveDensity(Chunk *chunk);
+
+/// Plants trees on a chunk that already has its caves. Trees that cross
+/// into other chunks are cut at the chunk border, and every chunk grows its
+/// own part of them, so only the chunk itself is written and no other chunk
+/// has to be decorated first. Every neighbour must already be carved as
+/// they read this chunk while carving.
+/// @param chunk The chunk to plant trees on.
+void generateStructures(Chunk *chunk);
+
+#endif
@@ -57,19 +57,19 @@ int main(int argc, char **argv) {
    F64 lastTime = getRealTime();
    F64 secondTime = lastTime;
 
-   initWorld();
-
-   S32 fpsCounter = 0;
-#define FPS_BUFFER_SIZE 256
-   char fpsBuffer[FPS_BUFFER_SIZE];
-
-   // Set initial camera position
+   // Set initial camera position. The world is loaded around it.
    Vec3 cameraPos;
    cameraPos.x = -5.0f;
    cameraPos.y = 80.0f;
    cameraPos.z = 0.0f;
    setCameraPosition(cameraPos);
 
+   initWorld();
+
+   S32 fpsCounter = 0;
+#define FPS_BUFFER_SIZE 256
+   char fpsBuffer[FPS_BUFFER_SIZE];
+
    // Set projection matrix
    mat4 proj;
    glm_perspective(1.5708f, 1440.0f / 900.0f, 0.01f, getViewDistance(), proj);
@@ -90,3 +90,15 @@ bool FrustumCullSquareBox(Frustum *frustum, Vec3 center, float halfExtent) {
    }
    return true;
 }
+
+bool FrustumCullBox(Frustum *frustum, Vec3 center, Vec3 halfExtents) {
+   for (S32 i = 0; i < FRUSTUM_LOOP_COUNT; ++i) {
+      FrustumPlane *plane = &frustum->planes[i];
+
+      F32 dist = planeDistance(center, plane);
+      F32 maxAbsDist = fabsf(plane->x) * halfExtents.x + fabsf(plane->y) * halfExtents.y + fabsf(plane->z) * halfExtents.z;
+      if (dist < -maxAbsDist)
+         return false;
+   }
+   return true;
+}
@@ -45,4 +45,6 @@ void computeFrustum(mat4 mvp, Frustum *frustum);
 
 bool FrustumCullSquareBox(Frustum *frustum, Vec3 center, float halfExtent);
 
+bool FrustumCullBox(Frustum *frustum, Vec3 center, Vec3 halfExtents);
+
 #endif
\ No newline at end of file
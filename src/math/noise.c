@@ -0,0 +1,794 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <open-simplex-noise.h>
+#include "math/noise.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NOISE_SSE2
+#endif
+
+#if defined(NOISE_SSE2) && defined(__AVX2__)
+#include <immintrin.h>
+#define NOISE_AVX2
+#endif
+
+// The kernel evaluates NOISE_LANES points at a time, 4 with SSE2 or 8 when
+// the compiler targets AVX2, and gives the same result as the library bit
+// for bit:
+//
+// The library adds up the vertices of the cell around a point in a fixed
+// order, skipping the ones that are too far away or in another part of the
+// cell, and then two extra vertices outside of it. The kernel adds up every
+// corner of the cell in that same order and masks out the ones the library
+// doesn't read, so they add exactly 0. The extra vertices are picked with
+// masks from the same comparisons the library branches on. Every delta is
+// computed as
+//
+//    ((d0 - offset) - squish * SQUISH) - step
+//
+// which is how the library writes each of them out. Nothing is fused or
+// reordered, so this only holds without -ffast-math. A compiler that fuses
+// multiplies and adds anyway fails the check in initNoise, and the batches
+// then use the library. The gradients are still looked up one point at a
+// time.
+//
+// The float kernel runs the same steps in single precision. Its results
+// are close to the library's but not the same.
+
+#ifdef NOISE_SSE2
+
+#define STRETCH_2D (-0.211324865405187)
+#define SQUISH_2D  (0.366025403784439)
+#define NORM_2D    (47.0)
+
+#define STRETCH_3D (-1.0 / 6.0)
+#define SQUISH_3D  (1.0 / 3.0)
+#define NORM_3D    (103.0)
+
+/// Points evaluated at once by the kernel.
+#ifdef NOISE_AVX2
+#define NOISE_LANES 8
+#else
+#define NOISE_LANES 4
+#endif
+
+/// Corners of the cell plus the extra vertices.
+#define NOISE2_CORNERS 4
+#define NOISE2_VERTICES 5
+#define NOISE3_CORNERS 8
+#define NOISE3_VERTICES 10
+
+/// Points the kernel is checked on before it is used.
+#define NOISE_CHECK_POINTS 512
+
+static const S8 gGradients2D[16] = {
+    5,  2,    2,  5,
+   -5,  2,   -2,  5,
+    5, -2,    2, -5,
+   -5, -2,   -2, -5,
+};
+
+static const S8 gGradients3D[72] = {
+   -11,  4,  4,     -4,  11,  4,    -4,  4,  11,
+    11,  4,  4,      4,  11,  4,     4,  4,  11,
+   -11, -4,  4,     -4, -11,  4,    -4, -4,  11,
+    11, -4,  4,      4, -11,  4,     4, -4,  11,
+   -11,  4, -4,     -4,  11, -4,    -4,  4, -11,
+    11,  4, -4,      4,  11, -4,     4,  4, -11,
+   -11, -4, -4,     -4, -11, -4,    -4, -4, -11,
+    11, -4, -4,      4, -11, -4,     4, -4, -11,
+};
+
+/// Corners of the 2D cell in the order the library adds them up. The
+/// library reads (0,0) below the diagonal and (1,1) above it.
+static const S32 gCorners2D[NOISE2_CORNERS][2] = {
+   {1, 0}, {0, 1}, {0, 0}, {1, 1}
+};
+
+/// Corners of the 3D cell in the order the library adds them up. The
+/// library reads the first 4 in the tetrahedron at (0,0,0), the 6 in the
+/// middle in the octahedron and the last 4 in the tetrahedron at (1,1,1).
+static const S32 gCorners3D[NOISE3_CORNERS][3] = {
+   {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, {1, 1, 0}, {1, 0, 1}, {0, 1, 1}, {1, 1, 1}
+};
+
+// Shuffles the permutation the way open_simplex_noise does. Older releases
+// of the library take the remainder of the seed as a signed number, which
+// picks a different entry whenever it is negative.
+static void shuffleNoiseTables(Noise *noise, S64 seed, bool signedSeed) {
+   S16 source[256];
+   for (S32 i = 0; i < 256; ++i)
+      source[i] = (S16)i;
+
+   U64 state = (U64)seed;
+   for (S32 i = 0; i < 3; ++i)
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+   for (S32 i = 255; i >= 0; --i) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      S32 r;
+      if (signedSeed) {
+         r = (S32)((S64)(state + 31) % (i + 1));
+         if (r < 0)
+            r += i + 1;
+      } else {
+         r = (S32)((state + 31) % (U64)(i + 1));
+      }
+      noise->perm[i] = source[r];
+      noise->gradIndex3D[i] = (S16)((noise->perm[i] % 24) * 3);
+      source[r] = source[i];
+   }
+}
+
+#ifdef NOISE_AVX2
+
+/// 8 doubles in two AVX registers.
+typedef struct F64x8 {
+   __m256d lo;
+   __m256d hi;
+} F64x8;
+
+/// One 32 bit integer or mask per point.
+typedef __m256i NoiseInts;
+
+#define F64X8_BINARY(name, intrinsic)                        \
+   static inline F64x8 name##F64x8(F64x8 a, F64x8 b) {       \
+      F64x8 r;                                               \
+      r.lo = intrinsic(a.lo, b.lo);                          \
+      r.hi = intrinsic(a.hi, b.hi);                          \
+      return r;                                              \
+   }
+
+#define F64X8_COMPARE(name, predicate)                       \
+   static inline F64x8 name##F64x8(F64x8 a, F64x8 b) {       \
+      F64x8 r;                                               \
+      r.lo = _mm256_cmp_pd(a.lo, b.lo, predicate);           \
+      r.hi = _mm256_cmp_pd(a.hi, b.hi, predicate);           \
+      return r;                                              \
+   }
+
+F64X8_BINARY(add, _mm256_add_pd)
+F64X8_BINARY(sub, _mm256_sub_pd)
+F64X8_BINARY(mul, _mm256_mul_pd)
+F64X8_BINARY(div, _mm256_div_pd)
+F64X8_BINARY(max, _mm256_max_pd)
+F64X8_BINARY(and, _mm256_and_pd)
+F64X8_BINARY(andNot, _mm256_andnot_pd)
+F64X8_BINARY(or, _mm256_or_pd)
+F64X8_COMPARE(lt, _CMP_LT_OS)
+F64X8_COMPARE(le, _CMP_LE_OS)
+F64X8_COMPARE(gt, _CMP_GT_OS)
+F64X8_COMPARE(ge, _CMP_GE_OS)
+
+static inline F64x8 loadF64x8(const F64 *p) {
+   F64x8 r;
+   r.lo = _mm256_loadu_pd(p);
+   r.hi = _mm256_loadu_pd(p + 4);
+   return r;
+}
+
+static inline void storeF64x8(F64 *p, F64x8 v) {
+   _mm256_storeu_pd(p, v.lo);
+   _mm256_storeu_pd(p + 4, v.hi);
+}
+
+static inline F64x8 setF64x8(F64 v) {
+   F64x8 r;
+   r.lo = r.hi = _mm256_set1_pd(v);
+   return r;
+}
+
+// Only for whole numbers.
+static inline NoiseInts toIntsF64x8(F64x8 v) {
+   return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(v.lo)), _mm256_cvttpd_epi32(v.hi), 1);
+}
+
+static inline F64x8 fromIntsF64x8(NoiseInts v) {
+   F64x8 r;
+   r.lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(v));
+   r.hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1));
+   return r;
+}
+
+// Packs the masks of a comparison into 32 bits per point.
+static inline NoiseInts maskF64x8(F64x8 v) {
+   __m256i evens = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+   __m256i lo = _mm256_permutevar8x32_epi32(_mm256_castpd_si256(v.lo), evens);
+   __m256i hi = _mm256_permutevar8x32_epi32(_mm256_castpd_si256(v.hi), evens);
+   return _mm256_blend_epi32(lo, hi, 0xF0);
+}
+
+// The library's fastFloor, rounds towards zero and steps down for
+// negative fractions.
+static inline F64x8 floorF64x8(F64x8 v) {
+   F64x8 truncated;
+   truncated.lo = _mm256_cvtepi32_pd(_mm256_cvttpd_epi32(v.lo));
+   truncated.hi = _mm256_cvtepi32_pd(_mm256_cvttpd_epi32(v.hi));
+   return subF64x8(truncated, andF64x8(ltF64x8(v, truncated), setF64x8(1.0)));
+}
+
+typedef __m256 F32x8;
+
+#define F32X8_BINARY(name, intrinsic)                        \
+   static inline F32x8 name##F32x8(F32x8 a, F32x8 b) {       \
+      return intrinsic(a, b);                                \
+   }
+
+#define F32X8_COMPARE(name, predicate)                       \
+   static inline F32x8 name##F32x8(F32x8 a, F32x8 b) {       \
+      return _mm256_cmp_ps(a, b, predicate);                 \
+   }
+
+F32X8_BINARY(add, _mm256_add_ps)
+F32X8_BINARY(sub, _mm256_sub_ps)
+F32X8_BINARY(mul, _mm256_mul_ps)
+F32X8_BINARY(div, _mm256_div_ps)
+F32X8_BINARY(max, _mm256_max_ps)
+F32X8_BINARY(and, _mm256_and_ps)
+F32X8_BINARY(andNot, _mm256_andnot_ps)
+F32X8_BINARY(or, _mm256_or_ps)
+F32X8_COMPARE(lt, _CMP_LT_OS)
+F32X8_COMPARE(le, _CMP_LE_OS)
+F32X8_COMPARE(gt, _CMP_GT_OS)
+F32X8_COMPARE(ge, _CMP_GE_OS)
+
+static inline F32x8 loadF32x8(const F32 *p) {
+   return _mm256_loadu_ps(p);
+}
+
+static inline void storeF32x8(F32 *p, F32x8 v) {
+   _mm256_storeu_ps(p, v);
+}
+
+static inline F32x8 setF32x8(F32 v) {
+   return _mm256_set1_ps(v);
+}
+
+static inline NoiseInts toIntsF32x8(F32x8 v) {
+   return _mm256_cvttps_epi32(v);
+}
+
+static inline F32x8 fromIntsF32x8(NoiseInts v) {
+   return _mm256_cvtepi32_ps(v);
+}
+
+static inline NoiseInts maskF32x8(F32x8 v) {
+   return _mm256_castps_si256(v);
+}
+
+static inline F32x8 floorF32x8(F32x8 v) {
+   F32x8 truncated = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(v));
+   return _mm256_sub_ps(truncated, _mm256_and_ps(_mm256_cmp_ps(v, truncated, _CMP_LT_OS), _mm256_set1_ps(1.0f)));
+}
+
+static inline NoiseInts andInts(NoiseInts a, NoiseInts b) { return _mm256_and_si256(a, b); }
+static inline NoiseInts andNotInts(NoiseInts a, NoiseInts b) { return _mm256_andnot_si256(a, b); }
+static inline NoiseInts orInts(NoiseInts a, NoiseInts b) { return _mm256_or_si256(a, b); }
+static inline NoiseInts xorInts(NoiseInts a, NoiseInts b) { return _mm256_xor_si256(a, b); }
+static inline NoiseInts addInts(NoiseInts a, NoiseInts b) { return _mm256_add_epi32(a, b); }
+static inline NoiseInts subInts(NoiseInts a, NoiseInts b) { return _mm256_sub_epi32(a, b); }
+static inline NoiseInts setInts(S32 v) { return _mm256_set1_epi32(v); }
+static inline void storeInts(S32 *p, NoiseInts v) { _mm256_storeu_si256((__m256i*)p, v); }
+
+#define NOISE_F64_VEC F64x8
+#define NOISE_F32_VEC F32x8
+#define NOISE_F64_KERNEL(name) name##F64x8
+#define NOISE_F32_KERNEL(name) name##F32x8
+
+#else
+
+/// 4 doubles in two SSE2 registers.
+typedef struct F64x4 {
+   __m128d lo;
+   __m128d hi;
+} F64x4;
+
+/// One 32 bit integer or mask per point.
+typedef __m128i NoiseInts;
+
+#define F64X4_BINARY(name, intrinsic)                        \
+   static inline F64x4 name##F64x4(F64x4 a, F64x4 b) {       \
+      F64x4 r;                                               \
+      r.lo = intrinsic(a.lo, b.lo);                          \
+      r.hi = intrinsic(a.hi, b.hi);                          \
+      return r;                                              \
+   }
+
+F64X4_BINARY(add, _mm_add_pd)
+F64X4_BINARY(sub, _mm_sub_pd)
+F64X4_BINARY(mul, _mm_mul_pd)
+F64X4_BINARY(div, _mm_div_pd)
+F64X4_BINARY(max, _mm_max_pd)
+F64X4_BINARY(and, _mm_and_pd)
+F64X4_BINARY(andNot, _mm_andnot_pd)
+F64X4_BINARY(or, _mm_or_pd)
+F64X4_BINARY(lt, _mm_cmplt_pd)
+F64X4_BINARY(le, _mm_cmple_pd)
+F64X4_BINARY(gt, _mm_cmpgt_pd)
+F64X4_BINARY(ge, _mm_cmpge_pd)
+
+static inline F64x4 loadF64x4(const F64 *p) {
+   F64x4 r;
+   r.lo = _mm_loadu_pd(p);
+   r.hi = _mm_loadu_pd(p + 2);
+   return r;
+}
+
+static inline void storeF64x4(F64 *p, F64x4 v) {
+   _mm_storeu_pd(p, v.lo);
+   _mm_storeu_pd(p + 2, v.hi);
+}
+
+static inline F64x4 setF64x4(F64 v) {
+   F64x4 r;
+   r.lo = r.hi = _mm_set1_pd(v);
+   return r;
+}
+
+// Only for whole numbers.
+static inline NoiseInts toIntsF64x4(F64x4 v) {
+   return _mm_unpacklo_epi64(_mm_cvttpd_epi32(v.lo), _mm_cvttpd_epi32(v.hi));
+}
+
+static inline F64x4 fromIntsF64x4(NoiseInts v) {
+   F64x4 r;
+   r.lo = _mm_cvtepi32_pd(v);
+   r.hi = _mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v));
+   return r;
+}
+
+// Packs the masks of a comparison into 32 bits per point.
+static inline NoiseInts maskF64x4(F64x4 v) {
+   return _mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(v.lo), _mm_castpd_ps(v.hi), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// The library's fastFloor, rounds towards zero and steps down for
+// negative fractions.
+static inline F64x4 floorF64x4(F64x4 v) {
+   F64x4 truncated;
+   truncated.lo = _mm_cvtepi32_pd(_mm_cvttpd_epi32(v.lo));
+   truncated.hi = _mm_cvtepi32_pd(_mm_cvttpd_epi32(v.hi));
+   return subF64x4(truncated, andF64x4(ltF64x4(v, truncated), setF64x4(1.0)));
+}
+
+typedef __m128 F32x4;
+
+#define F32X4_BINARY(name, intrinsic)                        \
+   static inline F32x4 name##F32x4(F32x4 a, F32x4 b) {       \
+      return intrinsic(a, b);                                \
+   }
+
+F32X4_BINARY(add, _mm_add_ps)
+F32X4_BINARY(sub, _mm_sub_ps)
+F32X4_BINARY(mul, _mm_mul_ps)
+F32X4_BINARY(div, _mm_div_ps)
+F32X4_BINARY(max, _mm_max_ps)
+F32X4_BINARY(and, _mm_and_ps)
+F32X4_BINARY(andNot, _mm_andnot_ps)
+F32X4_BINARY(or, _mm_or_ps)
+F32X4_BINARY(lt, _mm_cmplt_ps)
+F32X4_BINARY(le, _mm_cmple_ps)
+F32X4_BINARY(gt, _mm_cmpgt_ps)
+F32X4_BINARY(ge, _mm_cmpge_ps)
+
+static inline F32x4 loadF32x4(const F32 *p) {
+   return _mm_loadu_ps(p);
+}
+
+static inline void storeF32x4(F32 *p, F32x4 v) {
+   _mm_storeu_ps(p, v);
+}
+
+static inline F32x4 setF32x4(F32 v) {
+   return _mm_set1_ps(v);
+}
+
+static inline NoiseInts toIntsF32x4(F32x4 v) {
+   return _mm_cvttps_epi32(v);
+}
+
+static inline F32x4 fromIntsF32x4(NoiseInts v) {
+   return _mm_cvtepi32_ps(v);
+}
+
+static inline NoiseInts maskF32x4(F32x4 v) {
+   return _mm_castps_si128(v);
+}
+
+static inline F32x4 floorF32x4(F32x4 v) {
+   F32x4 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+   return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(v, truncated), _mm_set1_ps(1.0f)));
+}
+
+static inline NoiseInts andInts(NoiseInts a, NoiseInts b) { return _mm_and_si128(a, b); }
+static inline NoiseInts andNotInts(NoiseInts a, NoiseInts b) { return _mm_andnot_si128(a, b); }
+static inline NoiseInts orInts(NoiseInts a, NoiseInts b) { return _mm_or_si128(a, b); }
+static inline NoiseInts xorInts(NoiseInts a, NoiseInts b) { return _mm_xor_si128(a, b); }
+static inline NoiseInts addInts(NoiseInts a, NoiseInts b) { return _mm_add_epi32(a, b); }
+static inline NoiseInts subInts(NoiseInts a, NoiseInts b) { return _mm_sub_epi32(a, b); }
+static inline NoiseInts setInts(S32 v) { return _mm_set1_epi32(v); }
+static inline void storeInts(S32 *p, NoiseInts v) { _mm_storeu_si128((__m128i*)p, v); }
+
+#define NOISE_F64_VEC F64x4
+#define NOISE_F32_VEC F32x4
+#define NOISE_F64_KERNEL(name) name##F64x4
+#define NOISE_F32_KERNEL(name) name##F32x4
+
+#endif
+
+/// What picks the extra vertices of NOISE_LANES 3D points, as 32 bit masks. The
+/// comparisons are made in the kernel's precision, everything after them
+/// only moves masks around so it is shared by both.
+typedef struct NoiseChoice3 {
+   NoiseInts lower;             /// inSum <= 1
+   NoiseInts upper;             /// inSum >= 2
+   NoiseInts xGeY;
+   NoiseInts xLeY;
+   NoiseInts xGtZ;
+   NoiseInts zGtX;
+   NoiseInts yGtZ;
+   NoiseInts zGtY;
+   NoiseInts lowerWins[3];      /// 1 - inSum is greater than xins, yins, zins.
+   NoiseInts upperWins[3];      /// 3 - inSum is less than xins, yins, zins.
+   NoiseInts further[3];        /// xins + yins, xins + zins, yins + zins > 1
+   NoiseInts aLeB;              /// The scores of the first two pairs in the
+   NoiseInts aLtScore;          /// octahedron, compared with each other and
+   NoiseInts bLtScore;          /// with the score of the third.
+} NoiseChoice3;
+
+/// The two extra vertices of NOISE_LANES 3D points. Each delta is
+/// ((d0 - offset) - squish * SQUISH) - step and each lattice coordinate
+/// is base + offset + step.
+typedef struct NoiseExtra3 {
+   NoiseInts offset[2][3];
+   NoiseInts step[2][3];
+   NoiseInts squish[2];
+} NoiseExtra3;
+
+static inline NoiseInts selectInts(NoiseInts mask, NoiseInts a, NoiseInts b) {
+   return orInts(andInts(mask, a), andNotInts(mask, b));
+}
+
+static inline NoiseInts chooseInts(NoiseInts mask, S32 a, S32 b) {
+   return addInts(setInts(b), andInts(mask, setInts(a - b)));
+}
+
+static inline NoiseInts notInts(NoiseInts mask) {
+   return xorInts(mask, setInts(-1));
+}
+
+// -1 along the first axis missing from a point, 1 along the others.
+static inline void missingAxis3(const NoiseInts point[3], NoiseInts out[3]) {
+   NoiseInts two = setInts(2);
+   NoiseInts one = setInts(1);
+   out[0] = subInts(one, andNotInts(point[0], two));
+   out[1] = subInts(one, andInts(point[0], andNotInts(point[1], two)));
+   out[2] = subInts(one, andInts(andInts(point[0], point[1]), two));
+}
+
+// 2 along the first axis of a point, 0 along the others.
+static inline void firstAxis3(const NoiseInts point[3], NoiseInts out[3]) {
+   NoiseInts two = setInts(2);
+   out[0] = andInts(point[0], two);
+   out[1] = andNotInts(point[0], andInts(point[1], two));
+   out[2] = andNotInts(orInts(point[0], point[1]), two);
+}
+
+// The tetrahedron at (0,0,0). Points are masks per axis, the library's
+// 0x01, 0x02 and 0x04 bits.
+static void pickLowerVertices3(const NoiseChoice3 *c, NoiseExtra3 *e) {
+   NoiseInts zero = setInts(0);
+   NoiseInts all = setInts(-1);
+   NoiseInts zForB = andInts(c->xGeY, c->zGtY);
+   NoiseInts zForA = andNotInts(zForB, andNotInts(c->xGeY, c->zGtX));
+   NoiseInts a[3] = { notInts(zForA), zero, zForA };
+   NoiseInts b[3] = { zero, notInts(zForB), zForB };
+   NoiseInts wins = orInts(
+      selectInts(zForA, c->lowerWins[2], c->lowerWins[0]),
+      selectInts(zForB, c->lowerWins[2], c->lowerWins[1]));
+   NoiseInts pickB = selectInts(zForB, c->zGtX, selectInts(zForA, c->yGtZ, notInts(c->xGeY)));
+
+   NoiseInts won[3];
+   NoiseInts both[3];
+   for (S32 i = 0; i < 3; ++i) {
+      won[i] = selectInts(pickB, b[i], a[i]);
+      both[i] = orInts(a[i], b[i]);
+   }
+
+   NoiseInts wonOffset[2][3];
+   wonOffset[0][0] = chooseInts(won[0], 1, -1);
+   wonOffset[1][0] = chooseInts(won[0], 1, 0);
+   wonOffset[0][1] = selectInts(won[1], setInts(1), andInts(won[0], all));
+   wonOffset[1][1] = selectInts(won[1], setInts(1), andNotInts(won[0], all));
+   wonOffset[0][2] = chooseInts(won[2], 1, 0);
+   wonOffset[1][2] = chooseInts(won[2], 1, -1);
+
+   for (S32 i = 0; i < 3; ++i) {
+      e->offset[0][i] = selectInts(wins, wonOffset[0][i], chooseInts(both[i], 1, 0));
+      e->offset[1][i] = selectInts(wins, wonOffset[1][i], chooseInts(both[i], 1, -1));
+      e->step[0][i] = e->step[1][i] = zero;
+   }
+   e->squish[0] = andNotInts(wins, setInts(2));
+   e->squish[1] = andNotInts(wins, setInts(1));
+}
+
+// The tetrahedron at (1,1,1).
+static void pickUpperVertices3(const NoiseChoice3 *c, NoiseExtra3 *e) {
+   NoiseInts zero = setInts(0);
+   NoiseInts all = setInts(-1);
+   NoiseInts one = setInts(1);
+   NoiseInts zForB = andInts(c->xLeY, c->yGtZ);
+   NoiseInts zForA = andNotInts(zForB, andNotInts(c->xLeY, c->xGtZ));
+   NoiseInts a[3] = { zForA, all, notInts(zForA) };
+   NoiseInts b[3] = { all, zForB, notInts(zForB) };
+   NoiseInts wins = orInts(
+      selectInts(zForA, c->upperWins[2], c->upperWins[0]),
+      selectInts(zForB, c->upperWins[2], c->upperWins[1]));
+   NoiseInts pickB = selectInts(zForB, c->xGtZ, selectInts(zForA, c->zGtY, notInts(c->xLeY)));
+
+   NoiseInts won[3];
+   NoiseInts both[3];
+   for (S32 i = 0; i < 3; ++i) {
+      won[i] = selectInts(pickB, b[i], a[i]);
+      both[i] = andInts(a[i], b[i]);
+   }
+
+   NoiseInts wonOffset[2][3];
+   wonOffset[0][0] = chooseInts(won[0], 2, 0);
+   wonOffset[1][0] = chooseInts(won[0], 1, 0);
+   wonOffset[0][1] = wonOffset[1][1] = andInts(won[1], one);
+   wonOffset[0][2] = chooseInts(won[2], 1, 0);
+   wonOffset[1][2] = chooseInts(won[2], 2, 0);
+
+   for (S32 i = 0; i < 3; ++i) {
+      e->offset[0][i] = selectInts(wins, wonOffset[0][i], chooseInts(both[i], 1, 0));
+      e->offset[1][i] = selectInts(wins, wonOffset[1][i], chooseInts(both[i], 2, 0));
+      e->step[0][i] = e->step[1][i] = zero;
+   }
+   NoiseInts wonY = andInts(wins, won[1]);
+   e->step[0][1] = andInts(wonY, andNotInts(won[0], one));
+   e->step[1][1] = andInts(wonY, andInts(won[0], one));
+   e->squish[0] = chooseInts(wins, 3, 1);
+   e->squish[1] = chooseInts(wins, 3, 2);
+}
+
+// The octahedron in the middle.
+static void pickMiddleVertices3(const NoiseChoice3 *c, NoiseExtra3 *e) {
+   const NoiseInts *f = c->further;
+   NoiseInts replaceA = andInts(c->aLeB, c->aLtScore);
+   NoiseInts replaceB = andNotInts(replaceA, andNotInts(c->aLeB, c->bLtScore));
+   NoiseInts point[3] = { notInts(f[2]), f[2], f[2] };
+   NoiseInts a[3] = { f[0], f[0], notInts(f[0]) };
+   NoiseInts b[3] = { f[1], notInts(f[1]), f[1] };
+   NoiseInts aFurther = selectInts(replaceA, f[2], f[0]);
+   NoiseInts bFurther = selectInts(replaceB, f[2], f[1]);
+   NoiseInts same = notInts(xorInts(aFurther, bFurther));
+   NoiseInts sameFurther = andInts(same, aFurther);
+   NoiseInts sameNearer = andNotInts(aFurther, same);
+
+   NoiseInts both[3];
+   NoiseInts either[3];
+   NoiseInts nearer[3];
+   NoiseInts furtherPoint[3];
+   for (S32 i = 0; i < 3; ++i) {
+      a[i] = selectInts(replaceA, point[i], a[i]);
+      b[i] = selectInts(replaceB, point[i], b[i]);
+      both[i] = andInts(a[i], b[i]);
+      either[i] = orInts(a[i], b[i]);
+      furtherPoint[i] = selectInts(aFurther, a[i], b[i]);
+      nearer[i] = selectInts(aFurther, b[i], a[i]);
+   }
+
+   NoiseInts splitOffset[3];
+   NoiseInts nearOffset[3];
+   NoiseInts farOffset[3];
+   NoiseInts splitStep[3];
+   missingAxis3(furtherPoint, splitOffset);
+   missingAxis3(either, nearOffset);
+   firstAxis3(both, farOffset);
+   firstAxis3(nearer, splitStep);
+
+   for (S32 i = 0; i < 3; ++i) {
+      e->offset[0][i] = selectInts(same, andInts(sameFurther, setInts(1)), splitOffset[i]);
+      e->offset[1][i] = orInts(andInts(sameFurther, farOffset[i]), andInts(sameNearer, nearOffset[i]));
+      e->step[0][i] = setInts(0);
+      e->step[1][i] = andNotInts(same, splitStep[i]);
+   }
+   e->squish[0] = selectInts(same, andInts(sameFurther, setInts(3)), setInts(1));
+   e->squish[1] = selectInts(sameNearer, setInts(1), setInts(2));
+}
+
+// Picks the extra vertices the way the library does, for all 3 parts of
+// the cell, and keeps the one each point is in.
+static inline void pickExtraVertices3(const NoiseChoice3 *c, NoiseExtra3 *e) {
+   NoiseExtra3 lower, upper;
+   pickLowerVertices3(c, &lower);
+   pickUpperVertices3(c, &upper);
+   pickMiddleVertices3(c, e);
+   for (S32 i = 0; i < 2; ++i) {
+      for (S32 j = 0; j < 3; ++j) {
+         e->offset[i][j] = selectInts(c->lower, lower.offset[i][j], selectInts(c->upper, upper.offset[i][j], e->offset[i][j]));
+         e->step[i][j] = selectInts(c->lower, lower.step[i][j], selectInts(c->upper, upper.step[i][j], e->step[i][j]));
+      }
+      e->squish[i] = selectInts(c->lower, lower.squish[i], selectInts(c->upper, upper.squish[i], e->squish[i]));
+   }
+}
+
+#define NoiseReal F64
+#define NoiseVec NOISE_F64_VEC
+#define NOISE_KERNEL(name) NOISE_F64_KERNEL(name)
+#include "math/noiseKernel.h"
+#undef NoiseReal
+#undef NoiseVec
+#undef NOISE_KERNEL
+
+#define NoiseReal F32
+#define NoiseVec NOISE_F32_VEC
+#define NOISE_KERNEL(name) NOISE_F32_KERNEL(name)
+#include "math/noiseKernel.h"
+#undef NoiseReal
+#undef NoiseVec
+#undef NOISE_KERNEL
+
+// Copies a group of up to NOISE_LANES coordinates, repeating the first.
+static inline const F64 *padF64(const F64 *p, S32 count, F64 *padded) {
+   if (count >= NOISE_LANES)
+      return p;
+   for (S32 i = 0; i < NOISE_LANES; ++i)
+      padded[i] = p[i < count ? i : 0];
+   return padded;
+}
+
+static inline const F32 *padF32(const F32 *p, S32 count, F32 *padded) {
+   if (count >= NOISE_LANES)
+      return p;
+   for (S32 i = 0; i < NOISE_LANES; ++i)
+      padded[i] = p[i < count ? i : 0];
+   return padded;
+}
+
+static void kernelNoise2Batch(const Noise *noise, const F64 *x, const F64 *y, F64 *out, S32 count) {
+   for (S32 first = 0; first < count; first += NOISE_LANES) {
+      S32 lanes = count - first;
+      F64 px[NOISE_LANES], py[NOISE_LANES], result[NOISE_LANES];
+      NOISE_F64_KERNEL(noise2)(noise, padF64(x + first, lanes, px), padF64(y + first, lanes, py), result);
+      for (S32 i = 0; i < lanes && i < NOISE_LANES; ++i)
+         out[first + i] = result[i];
+   }
+}
+
+static void kernelNoise3Batch(const Noise *noise, const F64 *x, const F64 *y, const F64 *z, F64 *out, S32 count) {
+   for (S32 first = 0; first < count; first += NOISE_LANES) {
+      S32 lanes = count - first;
+      F64 px[NOISE_LANES], py[NOISE_LANES], pz[NOISE_LANES], result[NOISE_LANES];
+      NOISE_F64_KERNEL(noise3)(noise, padF64(x + first, lanes, px), padF64(y + first, lanes, py), padF64(z + first, lanes, pz), result);
+      for (S32 i = 0; i < lanes && i < NOISE_LANES; ++i)
+         out[first + i] = result[i];
+   }
+}
+
+// Compares the kernel with the library. The points cover negative
+// coordinates, and whole numbers where the library's comparisons tie.
+static bool checkNoiseKernel(const Noise *noise) {
+   F64 x[NOISE_CHECK_POINTS];
+   F64 y[NOISE_CHECK_POINTS];
+   F64 z[NOISE_CHECK_POINTS];
+   U64 state = 1;
+   for (S32 i = 0; i < NOISE_CHECK_POINTS; ++i) {
+      F64 *axes[3] = { x, y, z };
+      for (S32 j = 0; j < 3; ++j) {
+         state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+         F64 v = (F64)(S32)((state >> 40) & 0xFFFF) / 128.0 - 256.0;
+         axes[j][i] = (i & 3) == 0 ? (F64)(S32)v : v;
+      }
+   }
+
+   for (S32 first = 0; first < NOISE_CHECK_POINTS; first += NOISE_BATCH_MAX) {
+      S32 count = NOISE_CHECK_POINTS - first < NOISE_BATCH_MAX ? NOISE_CHECK_POINTS - first : NOISE_BATCH_MAX;
+      F64 out2[NOISE_BATCH_MAX];
+      F64 out3[NOISE_BATCH_MAX];
+      kernelNoise2Batch(noise, x + first, y + first, out2, count);
+      kernelNoise3Batch(noise, x + first, y + first, z + first, out3, count);
+      for (S32 i = 0; i < count; ++i) {
+         S32 p = first + i;
+         if (out2[i] != open_simplex_noise2(noise->context, x[p], y[p]))
+            return false;
+         if (out3[i] != open_simplex_noise3(noise->context, x[p], y[p], z[p]))
+            return false;
+      }
+   }
+   return true;
+}
+
+#endif
+
+void initNoise(Noise *noise, S64 seed) {
+   open_simplex_noise(seed, &noise->context);
+   noise->vectorized = false;
+#ifdef NOISE_SSE2
+   for (S32 i = 0; i < 2 && !noise->vectorized; ++i) {
+      shuffleNoiseTables(noise, seed, i == 1);
+      noise->vectorized = checkNoiseKernel(noise);
+   }
+#endif
+}
+
+void freeNoise(Noise *noise) {
+   open_simplex_noise_free(noise->context);
+   noise->context = NULL;
+}
+
+void sampleNoise2Batch(const Noise *noise, const F64 *x, const F64 *y, F64 *out, S32 count) {
+   assert(count >= 0 && count <= NOISE_BATCH_MAX);
+#ifdef NOISE_SSE2
+   if (noise->vectorized) {
+      kernelNoise2Batch(noise, x, y, out, count);
+      return;
+   }
+#endif
+   for (S32 i = 0; i < count; ++i)
+      out[i] = open_simplex_noise2(noise->context, x[i], y[i]);
+}
+
+void sampleNoise3Batch(const Noise *noise, const F64 *x, const F64 *y, const F64 *z, F64 *out, S32 count) {
+   assert(count >= 0 && count <= NOISE_BATCH_MAX);
+#ifdef NOISE_SSE2
+   if (noise->vectorized) {
+      kernelNoise3Batch(noise, x, y, z, out, count);
+      return;
+   }
+#endif
+   for (S32 i = 0; i < count; ++i)
+      out[i] = open_simplex_noise3(noise->context, x[i], y[i], z[i]);
+}
+
+void sampleNoise2BatchF32(const Noise *noise, const F32 *x, const F32 *y, F32 *out, S32 count) {
+   assert(count >= 0 && count <= NOISE_BATCH_MAX);
+#ifdef NOISE_SSE2
+   if (noise->vectorized) {
+      for (S32 first = 0; first < count; first += NOISE_LANES) {
+         S32 lanes = count - first;
+         F32 px[NOISE_LANES], py[NOISE_LANES], result[NOISE_LANES];
+         NOISE_F32_KERNEL(noise2)(noise, padF32(x + first, lanes, px), padF32(y + first, lanes, py), result);
+         for (S32 i = 0; i < lanes && i < NOISE_LANES; ++i)
+            out[first + i] = result[i];
+      }
+      return;
+   }
+#endif
+   for (S32 i = 0; i < count; ++i)
+      out[i] = (F32)open_simplex_noise2(noise->context, x[i], y[i]);
+}
+
+void sampleNoise3BatchF32(const Noise *noise, const F32 *x, const F32 *y, const F32 *z, F32 *out, S32 count) {
+   assert(count >= 0 && count <= NOISE_BATCH_MAX);
+#ifdef NOISE_SSE2
+   if (noise->vectorized) {
+      for (S32 first = 0; first < count; first += NOISE_LANES) {
+         S32 lanes = count - first;
+         F32 px[NOISE_LANES], py[NOISE_LANES], pz[NOISE_LANES], result[NOISE_LANES];
+         NOISE_F32_KERNEL(noise3)(noise, padF32(x + first, lanes, px), padF32(y + first, lanes, py), padF32(z + first, lanes, pz), result);
+         for (S32 i = 0; i < lanes && i < NOISE_LANES; ++i)
+            out[first + i] = result[i];
+      }
+      return;
+   }
+#endif
+   for (S32 i = 0; i < count; ++i)
+      out[i] = (F32)open_simplex_noise3(noise->context, x[i], y[i], z[i]);
+}
@@ -0,0 +1,74 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _MATH_NOISE_H_
+#define _MATH_NOISE_H_
+
+#include "base/types.h"
+
+struct osn_context;
+
+/// The most points that are ever evaluated in a single call, a whole
+/// number of kernel groups.
+#define NOISE_BATCH_MAX 48
+
+/// OpenSimplex noise. Single points go through the library, batches through
+/// a vector kernel that gives the same results bit for bit. The kernel does
+/// 4 points at a time with SSE2 and 8 with AVX2, see JEEFCRAFT_AVX2. The kernel needs
+/// the library's permutation tables, so it shuffles its own copy from the
+/// same seed.
+typedef struct Noise {
+   struct osn_context *context;  /// The library's generator.
+   S16 perm[256];                /// Permutation of the lattice hashes, the same as the library's.
+   S16 gradIndex3D[256];         /// perm mapped to the first component of a 3D gradient.
+   bool vectorized;              /// False when the kernel doesn't match the library. The batches then use the library too.
+} Noise;
+
+/// Creates the library's generator and the kernel's tables. The kernel is
+/// checked against the library on a few points and only used if it agrees.
+/// @param noise The generator to set up.
+/// @param seed The seed passed to open_simplex_noise.
+void initNoise(Noise *noise, S64 seed);
+
+/// @param noise The generator to free.
+void freeNoise(Noise *noise);
+
+/// Evaluates open_simplex_noise2 at several points at once.
+/// @param noise The noise generator.
+/// @param x The x coordinate of each point.
+/// @param y The y coordinate of each point.
+/// @param out Receives the noise value of each point.
+/// @param count The number of points [0, NOISE_BATCH_MAX].
+void sampleNoise2Batch(const Noise *noise, const F64 *x, const F64 *y, F64 *out, S32 count);
+
+/// Evaluates open_simplex_noise3 at several points at once.
+/// @param noise The noise generator.
+/// @param x The x coordinate of each point.
+/// @param y The y coordinate of each point.
+/// @param z The z coordinate of each point.
+/// @param out Receives the noise value of each point.
+/// @param count The number of points [0, NOISE_BATCH_MAX].
+void sampleNoise3Batch(const Noise *noise, const F64 *x, const F64 *y, const F64 *z, F64 *out, S32 count);
+
+/// Single precision sampleNoise2Batch. Each group of points takes one
+/// register instead of two, so it is faster, but the result is only close
+/// to the library's. Nothing that has to be the same for a seed can use it.
+void sampleNoise2BatchF32(const Noise *noise, const F32 *x, const F32 *y, F32 *out, S32 count);
+
+/// Single precision sampleNoise3Batch, see sampleNoise2BatchF32.
+void sampleNoise3BatchF32(const Noise *noise, const F32 *x, const F32 *y, const F32 *z, F32 *out, S32 count);
+
+#endif
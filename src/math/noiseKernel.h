@@ -0,0 +1,278 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+// The noise kernel, included by noise.c once for each precision. It has no
+// include guard on purpose. Expects:
+//
+//    NoiseReal          The scalar type.
+//    NoiseVec           NOISE_LANES of them.
+//    NOISE_KERNEL(name) Appends the type's suffix, name##F64x4 for example.
+//
+// and NOISE_KERNEL(add), NOISE_KERNEL(sub) and so on to be defined for the
+// vector type. Comparisons return masks that select with NOISE_KERNEL(and),
+// NOISE_KERNEL(mask) packs them into NoiseInts for pickExtraVertices3.
+
+#define V(name) NOISE_KERNEL(name)
+
+static inline NoiseVec V(select)(NoiseVec mask, NoiseVec a, NoiseVec b) {
+   return V(or)(V(and)(mask, a), V(andNot)(mask, b));
+}
+
+static inline NoiseVec V(choose)(NoiseVec mask, NoiseReal a, NoiseReal b) {
+   return V(select)(mask, V(set)(a), V(set)(b));
+}
+
+// The attenuated gradient of one vertex, 0 where the vertex is too far
+// away. The library skips those, adding 0 instead is the same.
+static inline NoiseVec V(contribution2)(const NoiseReal gradient[2][NOISE_LANES], NoiseVec dx, NoiseVec dy) {
+   NoiseVec attn = V(sub)(V(sub)(V(set)(2), V(mul)(dx, dx)), V(mul)(dy, dy));
+   attn = V(max)(attn, V(set)(0));
+   attn = V(mul)(attn, attn);
+   NoiseVec value = V(add)(V(mul)(V(load)(gradient[0]), dx), V(mul)(V(load)(gradient[1]), dy));
+   return V(mul)(V(mul)(attn, attn), value);
+}
+
+static inline NoiseVec V(contribution3)(const NoiseReal gradient[3][NOISE_LANES], NoiseVec dx, NoiseVec dy, NoiseVec dz) {
+   NoiseVec attn = V(sub)(V(sub)(V(sub)(V(set)(2), V(mul)(dx, dx)), V(mul)(dy, dy)), V(mul)(dz, dz));
+   attn = V(max)(attn, V(set)(0));
+   attn = V(mul)(attn, attn);
+   NoiseVec value = V(add)(V(add)(
+      V(mul)(V(load)(gradient[0]), dx),
+      V(mul)(V(load)(gradient[1]), dy)),
+      V(mul)(V(load)(gradient[2]), dz));
+   return V(mul)(V(mul)(attn, attn), value);
+}
+
+// (d0 - offset) - squish * SQUISH, with squish the sum of the offsets.
+static inline NoiseVec V(cornerDelta)(NoiseVec d0, S32 offset, S32 squish, NoiseReal squishConstant) {
+   return V(sub)(V(sub)(d0, V(set)((NoiseReal)offset)), V(set)((NoiseReal)squish * squishConstant));
+}
+
+// ((d0 - offset) - squish * SQUISH) - step
+static inline NoiseVec V(extraDelta)(NoiseVec d0, NoiseVec offset, NoiseVec squish, NoiseVec step) {
+   return V(sub)(V(sub)(V(sub)(d0, offset), squish), step);
+}
+
+static void V(noise2)(const Noise *noise, const NoiseReal *px, const NoiseReal *py, NoiseReal *out) {
+   NoiseVec x = V(load)(px);
+   NoiseVec y = V(load)(py);
+   NoiseVec one = V(set)(1);
+
+   // Place the points on the lattice.
+   NoiseVec stretch = V(mul)(V(add)(x, y), V(set)((NoiseReal)STRETCH_2D));
+   NoiseVec xs = V(add)(x, stretch);
+   NoiseVec ys = V(add)(y, stretch);
+   NoiseVec xsb = V(floor)(xs);
+   NoiseVec ysb = V(floor)(ys);
+   NoiseVec squish = V(mul)(V(add)(xsb, ysb), V(set)((NoiseReal)SQUISH_2D));
+   NoiseVec dx0 = V(sub)(x, V(add)(xsb, squish));
+   NoiseVec dy0 = V(sub)(y, V(add)(ysb, squish));
+   NoiseVec xins = V(sub)(xs, xsb);
+   NoiseVec yins = V(sub)(ys, ysb);
+   NoiseVec inSum = V(add)(xins, yins);
+
+   // The extra vertex. Below the diagonal (0,0) is read, then the vertex
+   // is (1,-1) or (-1,1) next to it or (1,1) across. Above it (1,1) is
+   // read, then the vertex is (2,0) or (0,2) next to it or (0,0) across.
+   NoiseVec below = V(le)(inSum, one);
+   NoiseVec xFirst = V(gt)(xins, yins);
+   NoiseVec zinsBelow = V(sub)(one, inSum);
+   NoiseVec zinsAbove = V(sub)(V(set)(2), inSum);
+   NoiseVec nextBelow = V(or)(V(gt)(zinsBelow, xins), V(gt)(zinsBelow, yins));
+   NoiseVec nextAbove = V(or)(V(lt)(zinsAbove, xins), V(lt)(zinsAbove, yins));
+
+   NoiseVec extX = V(select)(below,
+      V(select)(nextBelow, V(choose)(xFirst, 1, -1), one),
+      V(select)(nextAbove, V(choose)(xFirst, 2, 0), V(set)(0)));
+   NoiseVec extY = V(select)(below,
+      V(select)(nextBelow, V(choose)(xFirst, -1, 1), one),
+      V(select)(nextAbove, V(choose)(xFirst, 0, 2), V(set)(0)));
+   NoiseVec extSquish = V(select)(below, V(choose)(nextBelow, 0, 2), V(choose)(nextAbove, 2, 0));
+
+   // Gradients, looked up one point at a time.
+   S32 base[2][NOISE_LANES];
+   S32 ext[2][NOISE_LANES];
+   storeInts(base[0], V(toInts)(xsb));
+   storeInts(base[1], V(toInts)(ysb));
+   storeInts(ext[0], V(toInts)(V(add)(xsb, extX)));
+   storeInts(ext[1], V(toInts)(V(add)(ysb, extY)));
+
+   NoiseReal gradients[NOISE2_VERTICES][2][NOISE_LANES];
+   for (S32 lane = 0; lane < NOISE_LANES; ++lane) {
+      S32 xb = base[0][lane];
+      S32 yb = base[1][lane];
+      S32 hashX[2] = { noise->perm[xb & 0xFF], noise->perm[(xb + 1) & 0xFF] };
+      for (S32 i = 0; i < NOISE2_CORNERS; ++i) {
+         S32 index = noise->perm[(hashX[gCorners2D[i][0]] + yb + gCorners2D[i][1]) & 0xFF] & 0x0E;
+         gradients[i][0][lane] = (NoiseReal)gGradients2D[index];
+         gradients[i][1][lane] = (NoiseReal)gGradients2D[index + 1];
+      }
+      S32 index = noise->perm[(noise->perm[ext[0][lane] & 0xFF] + ext[1][lane]) & 0xFF] & 0x0E;
+      gradients[NOISE2_CORNERS][0][lane] = (NoiseReal)gGradients2D[index];
+      gradients[NOISE2_CORNERS][1][lane] = (NoiseReal)gGradients2D[index + 1];
+   }
+
+   // Add them up in the library's order. (0,0) is only read below the
+   // diagonal, (1,1) only above it.
+   NoiseVec value = V(set)(0);
+   for (S32 i = 0; i < NOISE2_CORNERS; ++i) {
+      S32 squishCount = gCorners2D[i][0] + gCorners2D[i][1];
+      NoiseVec dx = V(cornerDelta)(dx0, gCorners2D[i][0], squishCount, (NoiseReal)SQUISH_2D);
+      NoiseVec dy = V(cornerDelta)(dy0, gCorners2D[i][1], squishCount, (NoiseReal)SQUISH_2D);
+      NoiseVec contribution = V(contribution2)(gradients[i], dx, dy);
+      if (squishCount == 0)
+         contribution = V(and)(below, contribution);
+      else if (squishCount == 2)
+         contribution = V(andNot)(below, contribution);
+      value = V(add)(value, contribution);
+   }
+
+   NoiseVec squishExt = V(mul)(extSquish, V(set)((NoiseReal)SQUISH_2D));
+   NoiseVec dx = V(sub)(V(sub)(dx0, extX), squishExt);
+   NoiseVec dy = V(sub)(V(sub)(dy0, extY), squishExt);
+   value = V(add)(value, V(contribution2)(gradients[NOISE2_CORNERS], dx, dy));
+
+   V(store)(out, V(div)(value, V(set)((NoiseReal)NORM_2D)));
+}
+
+static void V(noise3)(const Noise *noise, const NoiseReal *px, const NoiseReal *py, const NoiseReal *pz, NoiseReal *out) {
+   NoiseVec p[3];
+   p[0] = V(load)(px);
+   p[1] = V(load)(py);
+   p[2] = V(load)(pz);
+
+   // Place the points on the lattice.
+   NoiseVec stretch = V(mul)(V(add)(V(add)(p[0], p[1]), p[2]), V(set)((NoiseReal)STRETCH_3D));
+   NoiseVec s[3];
+   NoiseVec sb[3];
+   for (S32 i = 0; i < 3; ++i) {
+      s[i] = V(add)(p[i], stretch);
+      sb[i] = V(floor)(s[i]);
+   }
+   NoiseVec squish = V(mul)(V(add)(V(add)(sb[0], sb[1]), sb[2]), V(set)((NoiseReal)SQUISH_3D));
+   NoiseVec d0[3];
+   NoiseVec ins[3];
+   for (S32 i = 0; i < 3; ++i) {
+      d0[i] = V(sub)(p[i], V(add)(sb[i], squish));
+      ins[i] = V(sub)(s[i], sb[i]);
+   }
+   NoiseVec inSum = V(add)(V(add)(ins[0], ins[1]), ins[2]);
+   NoiseVec one = V(set)(1);
+   NoiseVec lower = V(le)(inSum, one);
+   NoiseVec upper = V(ge)(inSum, V(set)(2));
+
+   // Everything the extra vertices are picked by. The scores of the
+   // octahedron are compared before any of them is replaced.
+   NoiseChoice3 choice;
+   choice.lower = V(mask)(lower);
+   choice.upper = V(mask)(upper);
+   choice.xGeY = V(mask)(V(ge)(ins[0], ins[1]));
+   choice.xLeY = V(mask)(V(le)(ins[0], ins[1]));
+   choice.xGtZ = V(mask)(V(gt)(ins[0], ins[2]));
+   choice.zGtX = V(mask)(V(gt)(ins[2], ins[0]));
+   choice.yGtZ = V(mask)(V(gt)(ins[1], ins[2]));
+   choice.zGtY = V(mask)(V(gt)(ins[2], ins[1]));
+   NoiseVec lowerWins = V(sub)(one, inSum);
+   NoiseVec upperWins = V(sub)(V(set)(3), inSum);
+   for (S32 i = 0; i < 3; ++i) {
+      choice.lowerWins[i] = V(mask)(V(gt)(lowerWins, ins[i]));
+      choice.upperWins[i] = V(mask)(V(lt)(upperWins, ins[i]));
+   }
+
+   NoiseVec pairSum[3] = { V(add)(ins[0], ins[1]), V(add)(ins[0], ins[2]), V(add)(ins[1], ins[2]) };
+   NoiseVec pairScore[3];
+   for (S32 i = 0; i < 3; ++i) {
+      NoiseVec further = V(gt)(pairSum[i], one);
+      choice.further[i] = V(mask)(further);
+      pairScore[i] = V(select)(further, V(sub)(pairSum[i], one), V(sub)(one, pairSum[i]));
+   }
+   choice.aLeB = V(mask)(V(le)(pairScore[0], pairScore[1]));
+   choice.aLtScore = V(mask)(V(lt)(pairScore[0], pairScore[2]));
+   choice.bLtScore = V(mask)(V(lt)(pairScore[1], pairScore[2]));
+
+   NoiseExtra3 extra;
+   pickExtraVertices3(&choice, &extra);
+
+   // Gradients, looked up one point at a time.
+   S32 base[3][NOISE_LANES];
+   S32 ext[2][3][NOISE_LANES];
+   for (S32 i = 0; i < 3; ++i) {
+      NoiseInts cell = V(toInts)(sb[i]);
+      storeInts(base[i], cell);
+      for (S32 j = 0; j < 2; ++j)
+         storeInts(ext[j][i], addInts(cell, addInts(extra.offset[j][i], extra.step[j][i])));
+   }
+
+   NoiseReal gradients[NOISE3_VERTICES][3][NOISE_LANES];
+   for (S32 lane = 0; lane < NOISE_LANES; ++lane) {
+      S32 xb = base[0][lane];
+      S32 yb = base[1][lane];
+      S32 zb = base[2][lane];
+      S32 hashX[2] = { noise->perm[xb & 0xFF], noise->perm[(xb + 1) & 0xFF] };
+      S32 hashXY[2][2];
+      for (S32 i = 0; i < 2; ++i) {
+         hashXY[i][0] = noise->perm[(hashX[i] + yb) & 0xFF];
+         hashXY[i][1] = noise->perm[(hashX[i] + yb + 1) & 0xFF];
+      }
+      for (S32 i = 0; i < NOISE3_CORNERS; ++i) {
+         const S32 *corner = gCorners3D[i];
+         S32 index = noise->gradIndex3D[(hashXY[corner[0]][corner[1]] + zb + corner[2]) & 0xFF];
+         gradients[i][0][lane] = (NoiseReal)gGradients3D[index];
+         gradients[i][1][lane] = (NoiseReal)gGradients3D[index + 1];
+         gradients[i][2][lane] = (NoiseReal)gGradients3D[index + 2];
+      }
+      for (S32 i = 0; i < 2; ++i) {
+         S32 hash = noise->perm[(noise->perm[ext[i][0][lane] & 0xFF] + ext[i][1][lane]) & 0xFF];
+         S32 index = noise->gradIndex3D[(hash + ext[i][2][lane]) & 0xFF];
+         gradients[NOISE3_CORNERS + i][0][lane] = (NoiseReal)gGradients3D[index];
+         gradients[NOISE3_CORNERS + i][1][lane] = (NoiseReal)gGradients3D[index + 1];
+         gradients[NOISE3_CORNERS + i][2][lane] = (NoiseReal)gGradients3D[index + 2];
+      }
+   }
+
+   // Add them up in the library's order. The first 4 corners are read in
+   // the lower tetrahedron, the 6 in the middle in the octahedron and the
+   // last 4 in the upper tetrahedron.
+   NoiseVec value = V(set)(0);
+   for (S32 i = 0; i < NOISE3_CORNERS; ++i) {
+      S32 squishCount = gCorners3D[i][0] + gCorners3D[i][1] + gCorners3D[i][2];
+      NoiseVec dx = V(cornerDelta)(d0[0], gCorners3D[i][0], squishCount, (NoiseReal)SQUISH_3D);
+      NoiseVec dy = V(cornerDelta)(d0[1], gCorners3D[i][1], squishCount, (NoiseReal)SQUISH_3D);
+      NoiseVec dz = V(cornerDelta)(d0[2], gCorners3D[i][2], squishCount, (NoiseReal)SQUISH_3D);
+      NoiseVec contribution = V(contribution3)(gradients[i], dx, dy, dz);
+      if (squishCount == 0)
+         contribution = V(and)(lower, contribution);
+      else if (squishCount == 1)
+         contribution = V(andNot)(upper, contribution);
+      else if (squishCount == 2)
+         contribution = V(andNot)(lower, contribution);
+      else
+         contribution = V(and)(upper, contribution);
+      value = V(add)(value, contribution);
+   }
+
+   for (S32 i = 0; i < 2; ++i) {
+      NoiseVec squishExt = V(mul)(V(fromInts)(extra.squish[i]), V(set)((NoiseReal)SQUISH_3D));
+      NoiseVec d[3];
+      for (S32 j = 0; j < 3; ++j)
+         d[j] = V(extraDelta)(d0[j], V(fromInts)(extra.offset[i][j]), squishExt, V(fromInts)(extra.step[i][j]));
+      value = V(add)(value, V(contribution3)(gradients[NOISE3_CORNERS + i], d[0], d[1], d[2]));
+   }
+
+   V(store)(out, V(div)(value, V(set)((NoiseReal)NORM_3D)));
+}
+
+#undef V
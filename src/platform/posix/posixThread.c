@@ -0,0 +1,99 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "platform/thread.h"
+
+struct Thread {
+   pthread_t handle;
+   ThreadFunction function;
+   void *userData;
+};
+
+struct Mutex {
+   pthread_mutex_t handle;
+};
+
+struct ConditionVariable {
+   pthread_cond_t handle;
+};
+
+static void* threadEntry(void *userData) {
+   Thread *thread = (Thread*)userData;
+   thread->function(thread->userData);
+   return NULL;
+}
+
+Thread* createThread(ThreadFunction function, void *userData) {
+   Thread *thread = (Thread*)malloc(sizeof(Thread));
+   thread->function = function;
+   thread->userData = userData;
+   if (pthread_create(&thread->handle, NULL, threadEntry, thread) != 0) {
+      free(thread);
+      return NULL;
+   }
+   return thread;
+}
+
+void joinThread(Thread *thread) {
+   pthread_join(thread->handle, NULL);
+   free(thread);
+}
+
+S32 getProcessorCount() {
+   long count = sysconf(_SC_NPROCESSORS_ONLN);
+   return count > 0 ? (S32)count : 1;
+}
+
+Mutex* createMutex() {
+   Mutex *mutex = (Mutex*)malloc(sizeof(Mutex));
+   pthread_mutex_init(&mutex->handle, NULL);
+   return mutex;
+}
+
+void freeMutex(Mutex *mutex) {
+   pthread_mutex_destroy(&mutex->handle);
+   free(mutex);
+}
+
+void lockMutex(Mutex *mutex) {
+   pthread_mutex_lock(&mutex->handle);
+}
+
+void unlockMutex(Mutex *mutex) {
+   pthread_mutex_unlock(&mutex->handle);
+}
+
+ConditionVariable* createConditionVariable() {
+   ConditionVariable *condition = (ConditionVariable*)malloc(sizeof(ConditionVariable));
+   pthread_cond_init(&condition->handle, NULL);
+   return condition;
+}
+
+void freeConditionVariable(ConditionVariable *condition) {
+   pthread_cond_destroy(&condition->handle);
+   free(condition);
+}
+
+void waitConditionVariable(ConditionVariable *condition, Mutex *mutex) {
+   pthread_cond_wait(&condition->handle, &mutex->handle);
+}
+
+void broadcastConditionVariable(ConditionVariable *condition) {
+   pthread_cond_broadcast(&condition->handle);
+}
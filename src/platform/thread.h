@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#ifndef _PLATFORM_THREAD_H_
+#define _PLATFORM_THREAD_H_
+
+#include "base/types.h"
+
+/// Threads and the primitives to synchronize them. Each platform backend
+/// defines these structs in its own source file.
+typedef struct Thread Thread;
+typedef struct Mutex Mutex;
+typedef struct ConditionVariable ConditionVariable;
+
+typedef void (*ThreadFunction)(void *userData);
+
+/// Starts a new thread.
+/// @param function The function the thread runs.
+/// @param userData Passed to function.
+/// @return The thread or NULL if it couldn't be created.
+Thread* createThread(ThreadFunction function, void *userData);
+
+/// Waits for a thread to return and frees it.
+void joinThread(Thread *thread);
+
+/// @return The number of processors that can run threads, at least 1.
+S32 getProcessorCount();
+
+Mutex* createMutex();
+
+void freeMutex(Mutex *mutex);
+
+void lockMutex(Mutex *mutex);
+
+void unlockMutex(Mutex *mutex);
+
+ConditionVariable* createConditionVariable();
+
+void freeConditionVariable(ConditionVariable *condition);
+
+/// Unlocks the mutex and sleeps until the condition is signaled, then locks
+/// the mutex again. Can wake up spuriously, so always wait in a loop.
+void waitConditionVariable(ConditionVariable *condition, Mutex *mutex);
+
+/// Wakes up every thread waiting on the condition.
+void broadcastConditionVariable(ConditionVariable *condition);
+
+#endif
@@ -0,0 +1,102 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdlib.h>
+#include "platform/thread.h"
+
+struct Thread {
+   HANDLE handle;
+   ThreadFunction function;
+   void *userData;
+};
+
+// SRW locks and condition variables need Windows Vista or newer.
+struct Mutex {
+   SRWLOCK handle;
+};
+
+struct ConditionVariable {
+   CONDITION_VARIABLE handle;
+};
+
+static DWORD WINAPI threadEntry(LPVOID userData) {
+   Thread *thread = (Thread*)userData;
+   thread->function(thread->userData);
+   return 0;
+}
+
+Thread* createThread(ThreadFunction function, void *userData) {
+   Thread *thread = (Thread*)malloc(sizeof(Thread));
+   thread->function = function;
+   thread->userData = userData;
+   thread->handle = CreateThread(NULL, 0, threadEntry, thread, 0, NULL);
+   if (thread->handle == NULL) {
+      free(thread);
+      return NULL;
+   }
+   return thread;
+}
+
+void joinThread(Thread *thread) {
+   WaitForSingleObject(thread->handle, INFINITE);
+   CloseHandle(thread->handle);
+   free(thread);
+}
+
+S32 getProcessorCount() {
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   return info.dwNumberOfProcessors > 0 ? (S32)info.dwNumberOfProcessors : 1;
+}
+
+Mutex* createMutex() {
+   Mutex *mutex = (Mutex*)malloc(sizeof(Mutex));
+   InitializeSRWLock(&mutex->handle);
+   return mutex;
+}
+
+void freeMutex(Mutex *mutex) {
+   // SRW locks don't need to be destroyed.
+   free(mutex);
+}
+
+void lockMutex(Mutex *mutex) {
+   AcquireSRWLockExclusive(&mutex->handle);
+}
+
+void unlockMutex(Mutex *mutex) {
+   ReleaseSRWLockExclusive(&mutex->handle);
+}
+
+ConditionVariable* createConditionVariable() {
+   ConditionVariable *condition = (ConditionVariable*)malloc(sizeof(ConditionVariable));
+   InitializeConditionVariable(&condition->handle);
+   return condition;
+}
+
+void freeConditionVariable(ConditionVariable *condition) {
+   free(condition);
+}
+
+void waitConditionVariable(ConditionVariable *condition, Mutex *mutex) {
+   SleepConditionVariableSRW(&condition->handle, &mutex->handle, INFINITE, 0);
+}
+
+void broadcastConditionVariable(ConditionVariable *condition) {
+   WakeAllConditionVariable(&condition->handle);
+}
@@ -0,0 +1,227 @@
+//-----------------------------------------------------------------------------
+// Copyright 2018 Jeff Hutchinson
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench/bench.h"
+#include "game/chunk.h"
+#include "game/chunkPipeline.h"
+#include "game/worldFile.h"
+#include "game/worldGen.h"
+#include "platform/thread.h"
+
+// Generates a square of the world ahead of time and writes it to a world
+// file, so that it doesn't have to be generated on the first visit.
+//
+// The area is generated a tile of columns at a time so memory stays flat
+// however large it is. Each tile is loaded with a border of one chunk on
+// every side, so the chunks at its edge are carved against the same
+// neighbours they have in the game. The border is generated but not
+// written; the tile next to it writes those chunks.
+
+#define PREGEN_TILE_WIDTH 16
+
+/// The default world is the one the game generates.
+#define PREGEN_DEFAULT_SEED 0xDEADBEEFULL
+#define PREGEN_DEFAULT_RADIUS 16
+#define PREGEN_DEFAULT_TOP_CUBE 128
+
+typedef struct PregenOptions {
+   U64 seed;
+   S32 radius;           /// Chunk x and z from -radius to radius - 1 are generated.
+   S32 bottom;           /// Lowest chunk y that is generated.
+   S32 top;              /// One past the highest chunk y that is generated.
+   S32 threads;          /// Threads to generate on, including the main thread.
+   bool printHashes;     /// Print the content hash of every chunk.
+   const char *fileName;
+} PregenOptions;
+
+typedef struct Pregen {
+   PregenOptions options;
+   WorldFile worldFile;
+   Chunk *chunks;        /// Chunks of the tile being generated, border included.
+   Chunk **batch;        /// Points at chunks, handed to the pipeline.
+   U32 generatedCount;   /// Chunks generated, border included.
+   U64 worldHash;        /// Sum of the chunk hashes, so it doesn't depend on the tile size.
+} Pregen;
+
+static void printUsage() {
+   printf("Usage: JeefCraftPregen [options] [file]\n");
+   printf("   -seed <n>      World seed (default 0x%llX)\n", PREGEN_DEFAULT_SEED);
+   printf("   -radius <n>    Chunks from the origin on x and z (default %d)\n", PREGEN_DEFAULT_RADIUS);
+   printf("   -bottom <y>    Lowest chunk y (default 0)\n");
+   printf("   -top <y>       One past the highest chunk y (default %d)\n", PREGEN_DEFAULT_TOP_CUBE / CHUNK_HEIGHT);
+   printf("   -threads <n>   Threads to generate on (default: every processor)\n");
+   printf("   -hashes        Print the content hash of every chunk\n");
+   printf("The world is written to file, world.jcw by default.\n");
+}
+
+static bool parsePregenOptions(int argc, char **argv, PregenOptions *options) {
+   options->seed = PREGEN_DEFAULT_SEED;
+   options->radius = PREGEN_DEFAULT_RADIUS;
+   options->bottom = 0;
+   options->top = PREGEN_DEFAULT_TOP_CUBE / CHUNK_HEIGHT;
+   options->threads = getProcessorCount();
+   options->printHashes = false;
+   options->fileName = "world.jcw";
+
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+      if (strcmp(arg, "-hashes") == 0) {
+         options->printHashes = true;
+         continue;
+      }
+      if (arg[0] != '-') {
+         options->fileName = arg;
+         continue;
+      }
+      if (value == NULL)
+         return false;
+
+      if (strcmp(arg, "-seed") == 0)
+         options->seed = (U64)strtoull(value, NULL, 0);
+      else if (strcmp(arg, "-radius") == 0)
+         options->radius = atoi(value);
+      else if (strcmp(arg, "-bottom") == 0)
+         options->bottom = atoi(value);
+      else if (strcmp(arg, "-top") == 0)
+         options->top = atoi(value);
+      else if (strcmp(arg, "-threads") == 0)
+         options->threads = atoi(value);
+      else
+         return false;
+      i++;
+   }
+
+   return options->radius > 0 && options->top > options->bottom && options->threads > 0;
+}
+
+static inline bool isTileBorder(S32 i, S32 count) {
+   return i == 0 || i == count - 1;
+}
+
+// Generates the tile of columns starting at chunk x, z and writes every
+// chunk that isn't part of its border.
+static bool generateTile(Pregen *pregen, S32 tileX, S32 tileZ) {
+   const PregenOptions *options = &pregen->options;
+   S32 width = options->radius - tileX < PREGEN_TILE_WIDTH ? options->radius - tileX : PREGEN_TILE_WIDTH;
+   S32 depth = options->radius - tileZ < PREGEN_TILE_WIDTH ? options->radius - tileZ : PREGEN_TILE_WIDTH;
+   S32 countX = width + 2;
+   S32 countZ = depth + 2;
+   S32 countY = options->top - options->bottom + 2;
+   S32 count = countX * countZ * countY;
+
+   // Chunks are stored x, z, y, the order the world generates them in.
+   memset(pregen->chunks, 0, sizeof(Chunk) * count);
+   for (S32 i = 0; i < count; ++i) {
+      Chunk *chunk = &pregen->chunks[i];
+      chunk->startX = tileX - 1 + i / (countZ * countY);
+      chunk->startZ = tileZ - 1 + (i / countY) % countZ;
+      chunk->startY = options->bottom - 1 + i % countY;
+      chunk->loaded = true;
+      insertChunk(chunk);
+      pregen->batch[i] = chunk;
+   }
+   runChunkPipeline(pregen->batch, count);
+   pregen->generatedCount += count;
+
+   bool ok = true;
+   for (S32 i = 0; i < count; ++i) {
+      Chunk *chunk = &pregen->chunks[i];
+      if (ok && !isTileBorder(i / (countZ * countY), countX) && !isTileBorder((i / countY) % countZ, countZ) && !isTileBorder(i % countY, countY)) {
+         U64 hash;
+         ok = writeWorldFileChunk(&pregen->worldFile, chunk, &hash);
+         pregen->worldHash += hash;
+         if (options->printHashes)
+            printf("%d %d %d %016llx\n", chunk->startX, chunk->startY, chunk->startZ, (unsigned long long)hash);
+      }
+   }
+
+   for (S32 i = 0; i < count; ++i) {
+      removeChunk(&pregen->chunks[i]);
+      freeChunkSection(&pregen->chunks[i].section);
+      freeCaveDensity(&pregen->chunks[i]);
+   }
+   return ok;
+}
+
+static void printPregenStats(const Pregen *pregen, F64 seconds) {
+   const char *stageNames[] = { NULL, "terrain", "caves", "trees" };
+   U32 writtenCount = pregen->worldFile.chunkCount;
+
+   ChunkPipelineStats stats;
+   getChunkPipelineStats(&stats);
+   printf("%u chunks in %.3f s on %d threads: %.1f chunks/s\n", writtenCount, seconds, pregen->options.threads, (F64)writtenCount / seconds);
+   printf("%u chunks generated including tile borders\n", pregen->generatedCount);
+   printf("%-10s %10.3f s %10.2f us/column\n", "columns", stats.columnSeconds, stats.columnSeconds * 1.0e6 / (F64)stats.columnCount);
+   for (S32 i = ChunkStatus_Terrain; i <= ChunkStatus_Decorated; ++i)
+      printf("%-10s %10.3f s %10.2f us/chunk\n", stageNames[i], stats.stageSeconds[i], stats.stageSeconds[i] * 1.0e6 / (F64)stats.stageCount[i]);
+   printf("%s: %lu KB, world hash %016llx\n", pregen->options.fileName, (unsigned long)(pregen->worldFile.size / 1024), (unsigned long long)pregen->worldHash);
+}
+
+int main(int argc, char **argv) {
+   Pregen pregen;
+   memset(&pregen, 0, sizeof(Pregen));
+   if (!parsePregenOptions(argc, argv, &pregen.options)) {
+      printUsage();
+      return 1;
+   }
+
+   const PregenOptions *options = &pregen.options;
+   if (!createWorldFile(&pregen.worldFile, options->fileName, options->seed)) {
+      fprintf(stderr, "Could not create %s\n", options->fileName);
+      return 1;
+   }
+
+   S32 maxTileCount = (PREGEN_TILE_WIDTH + 2) * (PREGEN_TILE_WIDTH + 2) * (options->top - options->bottom + 2);
+   pregen.chunks = (Chunk*)malloc(sizeof(Chunk) * maxTileCount);
+   pregen.batch = (Chunk**)malloc(sizeof(Chunk*) * maxTileCount);
+
+   initWorldGen(options->seed);
+   initChunkSectionPools();
+   initHashMap(&gChunkMap, maxTileCount);
+   initHashMap(&gChunkColumnMap, (PREGEN_TILE_WIDTH + 2) * (PREGEN_TILE_WIDTH + 2));
+
+   // The calling thread generates too. Nothing is meshed.
+   initChunkPipeline(options->threads - 1);
+   setChunkPipelineTarget(ChunkStatus_Decorated);
+   setChunkPipelineClock(benchWallTime);
+
+   bool ok = true;
+   F64 start = benchWallTime();
+   for (S32 x = -options->radius; ok && x < options->radius; x += PREGEN_TILE_WIDTH) {
+      for (S32 z = -options->radius; ok && z < options->radius; z += PREGEN_TILE_WIDTH)
+         ok = generateTile(&pregen, x, z);
+   }
+   F64 seconds = benchWallTime() - start;
+
+   ok = closeWorldFile(&pregen.worldFile) && ok;
+   if (ok)
+      printPregenStats(&pregen, seconds);
+   else
+      fprintf(stderr, "Could not write %s\n", options->fileName);
+
+   freeChunkPipeline();
+   freeHashMap(&gChunkMap);
+   freeHashMap(&gChunkColumnMap);
+   freeChunkSectionPools();
+   freeWorldGen();
+   free(pregen.chunks);
+   free(pregen.batch);
+   return ok ? 0 : 1;
+}